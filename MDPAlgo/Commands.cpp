@@ -1,5 +1,6 @@
 #include "Commands.hpp"
 #include <map>
+#include <algorithm>
 #include "Config.hpp"
 
 namespace MDP {
@@ -9,7 +10,7 @@ namespace MDP {
 	std::string ZeroPad(const T& value, int n_zero = 2)
 	{
 		std::string output = std::to_string(value);
-		return std::string(n_zero - min(n_zero, output.length()), '0') + output;
+		return std::string(n_zero - std::min<std::size_t>(n_zero, output.length()), '0') + output;
 	}
 
 	Command::Command(CommandType type, int distance, const ObjectState& state) :
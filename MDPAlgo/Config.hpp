@@ -1,6 +1,16 @@
 #pragma once
 
 #define	LogTSP 0
+//0 keeps the tour DP on its scalar kernel, 1 picks AVX2 at runtime when the CPU has it
+#define	TSPSimd 1
+//0 compiles SolveStats collection out of the solver, the struct then stays zeroed
+#define	SolverStats 1
+
+#if SolverStats >= 1
+#define SOLVER_STAT(expr) expr
+#else
+#define SOLVER_STAT(expr)
+#endif
 
 #define GetSetIntMacroV(Name, value) private: int _##Name = value; \
 public: int Get_##Name(){ return _##Name; }\
@@ -27,11 +37,17 @@ namespace MDP {
 		GetSetIntMacroV(TURN_RADIUS, 1);
 		GetSetIntMacroV(TURN_FACTOR, 1);
 		GetSetIntMacroV(ITERATIONS, 2000);
+		//worker threads for combination evaluation, 0 = all hardware threads
+		GetSetIntMacroV(THREADS, 0);
 
 		GetSetIntMacroV(LEFTWHEEL, 3);
 		GetSetIntMacroV(RIGHTWHEEL, 2);
 
 		GetSetBoolMacroV(LimitMax90, true);
 		GetSetBoolMacroV(OutsideCommand, false);
+		//pick view poses inside the tour DP instead of enumerating ITERATIONS combinations
+		GetSetBoolMacroV(GeneralizedTSP, true);
+		//search each leg with A* guided by an exact reverse cost-to-go per target pose
+		GetSetBoolMacroV(ReverseHeuristic, false);
 	};
 }
\ No newline at end of file
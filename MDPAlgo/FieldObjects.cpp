@@ -6,7 +6,7 @@
 
 namespace MDP {
 
-	bool is_valid(const POINT& center)
+	bool is_valid(const Point& center)
 	{
 		return center.x > 0 && center.y > 0 &&
 			center.x < Config::get().Get_WIDTH_BUFFER() - 1 && center.y < Config::get().Get_HEIGHT_BUFFER() - 1;
@@ -39,7 +39,7 @@ namespace MDP {
 		return os;
 	}
 
-	FieldObject::FieldObject(const POINT& start_loc, const POINT& dimen,
+	FieldObject::FieldObject(const Point& start_loc, const Point& dimen,
 		FaceDirection fd) :
 		ObjectState(start_loc, fd), m_dimen(dimen)
 	{
@@ -48,7 +48,7 @@ namespace MDP {
 		assert(dimen.y % 2 == 1);
 	}
 
-	void FieldObject::Update(const POINT& loc, FaceDirection fd)
+	void FieldObject::Update(const Point& loc, FaceDirection fd)
 	{
 		this->m_location = loc;
 		this->m_Fd = fd;
@@ -59,7 +59,7 @@ namespace MDP {
 		this->snapshot_id = ID;
 	}
 
-	bool FieldObject::IsInRect(const POINT& loc)
+	bool FieldObject::IsInRect(const Point& loc)
 	{
 		int dim_x = this->m_dimen.x / 2;
 		int dim_y = this->m_dimen.y / 2;
@@ -77,9 +77,9 @@ namespace MDP {
 			this->m_Fd = static_cast<FaceDirection>(static_cast<int>(this->m_Fd) + 1);
 	}
 
-	std::vector<POINT> FieldObject::GetRectPoints()
+	std::vector<Point> FieldObject::GetRectPoints()
 	{
-		std::vector<POINT> result;
+		std::vector<Point> result;
 		int dim_x = this->m_dimen.x / 2;
 		int dim_y = this->m_dimen.y / 2;
 		int startx = this->m_location.x - dim_x;
@@ -100,7 +100,7 @@ namespace MDP {
 		return this->m_Fd;
 	}
 
-	POINT FieldObject::GetLoc() const
+	Point FieldObject::GetLoc() const
 	{
 		return this->m_location;
 	}
@@ -122,14 +122,14 @@ namespace MDP {
 
 	/**********************************/
 
-	FieldBlock::FieldBlock(const POINT& start_loc, FaceDirection fd, int obstacle_id) :
+	FieldBlock::FieldBlock(const Point& start_loc, FaceDirection fd, int obstacle_id) :
 		FieldObject(start_loc, { 1,1 }, fd)
 	{
 		this->snapshot_id = obstacle_id;
 	}
 
 
-	GridBoxType FieldBlock::GetGridBoxType(const POINT& loc)
+	GridBoxType FieldBlock::GetGridBoxType(const Point& loc)
 	{
 		if (!this->IsInRect(loc))
 			return GridBoxType::GBT_Invalid;
@@ -147,7 +147,7 @@ namespace MDP {
 	std::vector<ObjectState> FieldBlock::GetViewState(bool retrying)
 	{
 		std::vector<ObjectState> output;
-		auto CheckAndAdd = [&output](const POINT& loc, FaceDirection fd, int snapshot_id = -1, int penalty = 0) {
+		auto CheckAndAdd = [&output](const Point& loc, FaceDirection fd, int snapshot_id = -1, int penalty = 0) {
 			if (is_valid(loc)) output.push_back(ObjectState(loc, fd, penalty, snapshot_id));
 		};
 
@@ -278,7 +278,7 @@ namespace MDP {
 
 	/***********************************************************/
 
-	FieldRobot::FieldRobot(const POINT& start_loc, FaceDirection fd) :
+	FieldRobot::FieldRobot(const Point& start_loc, FaceDirection fd) :
 		FieldObject(start_loc, {3,3}, fd)
 	{
 	}
@@ -291,7 +291,7 @@ namespace MDP {
 			this->m_Fd = static_cast<FaceDirection>(static_cast<int>(this->m_Fd) + 1);
 	}
 
-	GridBoxType FieldRobot::GetGridBoxType(const POINT& loc)
+	GridBoxType FieldRobot::GetGridBoxType(const Point& loc)
 	{
 		/*if (this->m_location.x == loc.x && this->m_location.y == loc.y &&
 			this->m_dimen.x == 1 && this->m_dimen.y == 1) {
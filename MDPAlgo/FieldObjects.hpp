@@ -1,5 +1,6 @@
 #pragma once
-#include <Windows.h>
+#include "Point.hpp"
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -25,24 +26,36 @@ namespace MDP {
 		GBT_Camera,
 	};
 
+	//(x, y, direction) in one word: POSE_COORD_BITS per coordinate, 4 for the direction
+	using PoseKey = uint32_t;
+	constexpr int POSE_COORD_BITS = 14;
+	static_assert(2 * POSE_COORD_BITS + 4 <= 32, "a PoseKey holds both coordinates and the direction");
+	//widest and tallest grid whose cells all pack into distinct keys, Grid and mdp-solve refuse bigger
+	constexpr long MAX_GRID_SIZE = 1L << POSE_COORD_BITS;
+
+	constexpr PoseKey PackPose(const Point& loc, FaceDirection fd)
+	{
+		constexpr long mask = MAX_GRID_SIZE - 1;
+		return (static_cast<PoseKey>(loc.x & mask) << (POSE_COORD_BITS + 4)) | (static_cast<PoseKey>(loc.y & mask) << 4) |
+			static_cast<PoseKey>(fd & 0xF);
+	}
+
 	struct ObjectState {
-		POINT m_location;
+		Point m_location;
 		FaceDirection m_Fd;
 		int penalty;
 		int snapshot_id;
 
 		ObjectState() = default;
 
-		ObjectState(const POINT& start_loc, FaceDirection fd, int penalty = 0, int snapshot_id = -1) :
+		ObjectState(const Point& start_loc, FaceDirection fd, int penalty = 0, int snapshot_id = -1) :
 			m_location(start_loc),  m_Fd(fd), snapshot_id(snapshot_id), penalty(penalty)
 		{
 		}
 		
-		ObjectState(const ObjectState& rhs) :
-			m_location(rhs.m_location), m_Fd(rhs.m_Fd), snapshot_id(rhs.snapshot_id),
-			penalty(rhs.penalty)
+		PoseKey Key() const
 		{
-
+			return PackPose(this->m_location, this->m_Fd);
 		}
 
 		bool operator==(const ObjectState& rhs) const
@@ -89,41 +102,41 @@ namespace MDP {
 	class FieldObject : protected ObjectState {
 
 	public:
-		FieldObject(const POINT& start_loc, const POINT& dimen = POINT{ 1,1 },
+		FieldObject(const Point& start_loc, const Point& dimen = Point{ 1,1 },
 			FaceDirection fd = FaceDirection::FD_North);
 
-		void Update(const POINT& loc, FaceDirection fd);
+		void Update(const Point& loc, FaceDirection fd);
 		void UpdateSnapshotID(int ID);
-		bool IsInRect(const POINT& loc);
+		bool IsInRect(const Point& loc);
 		virtual void ChangeDirection();
-		std::vector<POINT> GetRectPoints();
+		std::vector<Point> GetRectPoints();
 		FaceDirection GetDirection() const;
-		POINT GetLoc() const;
+		Point GetLoc() const;
 		int GetSnapshotID() const;
 		ObjectState& GetState();
 
 		virtual std::vector<ObjectState> GetViewState(bool retrying);
-		virtual GridBoxType GetGridBoxType(const POINT& loc) = 0;
+		virtual GridBoxType GetGridBoxType(const Point& loc) = 0;
 	protected:
-		POINT m_dimen;
+		Point m_dimen;
 	};
 	typedef std::shared_ptr<FieldObject> SFieldObject;
 
 	class FieldBlock : public FieldObject {
 
 	public:
-		FieldBlock(const POINT& start_loc, FaceDirection fd = FaceDirection::FD_North, 
+		FieldBlock(const Point& start_loc, FaceDirection fd = FaceDirection::FD_North, 
 			int obstacle_id = 1);
-		virtual GridBoxType GetGridBoxType(const POINT& loc) override;
+		virtual GridBoxType GetGridBoxType(const Point& loc) override;
 		virtual std::vector<ObjectState> GetViewState(bool retrying) override;
 	};
 
 	class FieldRobot : public FieldObject {
 
 	public:
-		FieldRobot(const POINT& start_loc = {1,1}, FaceDirection fd = FaceDirection::FD_North);
+		FieldRobot(const Point& start_loc = {1,1}, FaceDirection fd = FaceDirection::FD_North);
 		virtual void ChangeDirection() override;
-		virtual GridBoxType GetGridBoxType(const POINT& loc) override;
+		virtual GridBoxType GetGridBoxType(const Point& loc) override;
 
 	private:
 		std::vector<ObjectState> m_states;
@@ -135,13 +148,7 @@ struct std::hash<MDP::ObjectState>
 {
 	std::size_t operator()(const MDP::ObjectState& k) const
 	{
-		using std::hash;
-
-		std::size_t res = 17;
-		res = res * 31 + hash<int>()(k.m_location.x);
-		res = res * 31 + hash<int>()(k.m_location.y);
-		res = res * 31 + hash<int>()(k.m_Fd);
-		return res;
+		return std::hash<MDP::PoseKey>()(k.Key());
 	}
 };
 
@@ -150,11 +157,6 @@ struct std::hash<MDP::FieldStartEnd>
 {
 	std::size_t operator()(const MDP::FieldStartEnd& k) const
 	{
-		using std::hash;
-
-		std::size_t res = 17;
-		res = res * 31 + hash< MDP::ObjectState>()(k.Start);
-		res = res * 31 + hash< MDP::ObjectState>()(k.End);
-		return res;
+		return std::hash<uint64_t>()((static_cast<uint64_t>(k.Start.Key()) << 32) | k.End.Key());
 	}
 };
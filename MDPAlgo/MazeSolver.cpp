@@ -2,7 +2,14 @@
 #include <algorithm>
 #include <iterator>
 #include <queue>
-#include <set>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cmath>
+#include <tuple>
 #include "TSP.hpp"
 #include <iostream>
 #include "Utils.hpp"
@@ -15,7 +22,7 @@ namespace MDP {
 	};
 
 	const struct MoveDirection {
-		POINT dxdy;
+		Point dxdy;
 		FaceDirection direction;
 	}MOVE_DIRECTION[4]{
 		{ {1,0}, FaceDirection::FD_East},
@@ -55,24 +62,24 @@ namespace MDP {
 			case FaceDirection::FD_East: return 2;
 			case FaceDirection::FD_South: return 4;
 			case FaceDirection::FD_West: return 6;
+			default: return 0;
 			}
 		};
 		int d1 = get_direction_cost(fd1), d2 = get_direction_cost(fd2);
 		int diff = abs(d1 - d2);
-		return min(diff, 8 - diff);
+		return std::min(diff, 8 - diff);
 	}
 
 	int countBit(int val)
 	{
-		if (val == 0) return 0;
-		else
-			return (val & 1) + countBit(val >> 1);
+		return std::popcount(static_cast<unsigned int>(val));
 	}
 
 	std::vector<int> GetVisitOptions(int n)
 	{
 		std::vector<int> output;
-		int max_val = pow(2, n);
+		int max_val = 1 << n;
+		output.reserve(max_val);
 		for (int i = 0; i < max_val;i++)
 			output.push_back(i);
 		std::sort(output.begin(), output.end(), [](const int& l, const int& r) {
@@ -81,13 +88,14 @@ namespace MDP {
 		return output;
 	}
 
-	Grid::Grid(const POINT& size) : 
+	Grid::Grid(const Point& size) : 
 		mSize(size)
 	{
-
+		assert(this->FitsPoseKeys());
+		this->RebuildClearance();
 	}
 
-	bool Grid::IsValidCoord(const POINT& xy)
+	bool Grid::IsValidCoord(const Point& xy)
 	{
 		if (xy.x < 1 || xy.x >= this->mSize.x - 1 ||
 			xy.y < 1 || xy.y >= this->mSize.y - 1)
@@ -95,31 +103,90 @@ namespace MDP {
 		return true;
 	}
 
-	bool Grid::Reachable(const POINT& xy, bool turn, bool preTurn)
+	void Grid::RebuildClearance()
 	{
-		if (!this->IsValidCoord(xy))
-			return false;
-		for (auto& obj : this->mObjects) {
-			if (obj->GetLoc().x == 4 && obj->GetLoc().y <= 4 &&
-				xy.x < 4 && xy.y < 4)
-				continue;
-			//Must be at least 4 units away in total (x+y)
-			if (abs(obj->GetLoc().x - xy.x) + abs(obj->GetLoc().y - xy.y) >= 4)
-				continue;
-			if (turn) {
-				if (max(abs(obj->GetLoc().x - xy.x), abs(obj->GetLoc().y - xy.y)) < (Config::get().Get_EXPANDED_CELL() * 2 + 1))
-					return false;
+		this->mClearance.assign(this->mSize.x * this->mSize.y, 0);
+		this->mSafeCost.assign(this->mSize.x * this->mSize.y, 0);
+		for (int y = 0; y < this->mSize.y; y++)
+		{
+			for (int x = 0; x < this->mSize.x; x++)
+			{
+				if (this->IsValidCoord({ x, y }))
+					this->mClearance[y * this->mSize.x + x] = CL_Plain | CL_Turn | CL_PreTurn;
 			}
-			if (preTurn) {
-				if (max(abs(obj->GetLoc().x - xy.x), abs(obj->GetLoc().y - xy.y)) < (Config::get().Get_EXPANDED_CELL() * 2 + 1))
-					return false;
+		}
+		for (auto& obj : this->mObjects) {
+			this->StampClearance(obj->GetLoc());
+			this->StampSafeCost(obj->GetLoc());
+		}
+	}
+
+	void Grid::StampClearance(const Point& loc)
+	{
+		int turn_clearance = Config::get().Get_EXPANDED_CELL() * 2 + 1;
+		//Must be at least 4 units away in total (x+y), anything further is never blocked
+		for (int dy = -3; dy <= 3; dy++)
+		{
+			for (int dx = -3; dx <= 3; dx++)
+			{
+				if (abs(dx) + abs(dy) >= 4)
+					continue;
+				Point xy{ loc.x + dx, loc.y + dy };
+				if (xy.x < 0 || xy.x >= this->mSize.x ||
+					xy.y < 0 || xy.y >= this->mSize.y)
+					continue;
+				//start zone is exempted from obstacles placed right next to it
+				if (loc.x == 4 && loc.y <= 4 && xy.x < 4 && xy.y < 4)
+					continue;
+				int dist = std::max(abs(dx), abs(dy));
+				unsigned char blocked = 0;
+				if (dist < 2)
+					blocked |= CL_Plain | CL_Turn;
+				if (dist < turn_clearance)
+					blocked |= CL_Turn | CL_PreTurn;
+				this->mClearance[xy.y * this->mSize.x + xy.x] &= ~blocked;
 			}
-			else {
-				if (max(abs(obj->GetLoc().x - xy.x), abs(obj->GetLoc().y - xy.y)) < 2)
-					return false;
+		}
+	}
+
+	void Grid::StampSafeCost(const Point& loc)
+	{
+		//ring of cells at (2,2), (1,2) and (2,1) away from the obstacle
+		const Point offsets[]{ {2,2}, {1,2}, {2,1} };
+		int safe_cost = Config::get().Get_SAFE_COST();
+		for (auto& o : offsets)
+		{
+			for (int sx = -1; sx <= 1; sx += 2)
+			{
+				for (int sy = -1; sy <= 1; sy += 2)
+				{
+					Point xy{ loc.x + sx * o.x, loc.y + sy * o.y };
+					if (xy.x < 0 || xy.x >= this->mSize.x ||
+						xy.y < 0 || xy.y >= this->mSize.y)
+						continue;
+					this->mSafeCost[xy.y * this->mSize.x + xy.x] = safe_cost;
+				}
 			}
 		}
-		return true;
+	}
+
+	int Grid::GetSafeCost(const Point& xy) const
+	{
+		if (xy.x < 0 || xy.x >= this->mSize.x ||
+			xy.y < 0 || xy.y >= this->mSize.y)
+			return 0;
+		return this->mSafeCost[xy.y * this->mSize.x + xy.x];
+	}
+
+	bool Grid::Reachable(const Point& xy, bool turn, bool preTurn)
+	{
+		if (xy.x < 0 || xy.x >= this->mSize.x ||
+			xy.y < 0 || xy.y >= this->mSize.y)
+			return false;
+		//preTurn overrides the plain check, turn adds the expanded clearance on top of it
+		SOLVER_STAT(this->mReachableCalls++);
+		unsigned char layer = preTurn ? CL_PreTurn : (turn ? CL_Turn : CL_Plain);
+		return (this->mClearance[xy.y * this->mSize.x + xy.x] & layer) != 0;
 	}
 
 	std::vector<std::vector<ObjectState>> Grid::GetViewObstaclePositions(bool retrying)
@@ -138,17 +205,21 @@ namespace MDP {
 		return output;
 	}
 
-	void Grid::AddObstacle(const POINT& loc, FaceDirection dir)
+	void Grid::AddObstacle(const Point& loc, FaceDirection dir)
 	{
 		if (loc.x < 0 || loc.x >= this->mSize.x ||
 			loc.y < 0 || loc.y >= this->mSize.y)
 			return;
 		this->mObjects.push_back(std::make_shared<FieldBlock>(loc, dir));
+		this->StampClearance(loc);
+		this->StampSafeCost(loc);
 	}
 
 	void Grid::AddObstacle(const SFieldObject& obj)
 	{
 		this->mObjects.push_back(obj);
+		this->StampClearance(obj->GetLoc());
+		this->StampSafeCost(obj->GetLoc());
 	}
 
 	std::vector<SFieldObject> Grid::GetObjects() const
@@ -156,7 +227,209 @@ namespace MDP {
 		return this->mObjects;
 	}
 
-	MazeSolver::MazeSolver(const POINT& grid_size, const POINT& robot, FaceDirection robot_dir,
+	Point Grid::GetSize() const
+	{
+		return this->mSize;
+	}
+
+	bool Grid::Contains(const Point& xy) const
+	{
+		return xy.x >= 0 && xy.x < this->mSize.x && xy.y >= 0 && xy.y < this->mSize.y;
+	}
+
+	bool Grid::FitsPoseKeys() const
+	{
+		return this->mSize.x <= MAX_GRID_SIZE && this->mSize.y <= MAX_GRID_SIZE;
+	}
+
+	std::size_t Grid::GetReachableCalls() const
+	{
+		return this->mReachableCalls;
+	}
+
+	const PathCache::Entry* PathCache::Find(const ObjectState& start, const ObjectState& end) const
+	{
+		auto it = this->mEntries.find({ start, end });
+		if (it == this->mEntries.end())
+			return nullptr;
+		return &it->second;
+	}
+
+	void PathCache::Store(const ObjectState& start, const ObjectState& end, int cost, std::span<const MotionRun> runs)
+	{
+		this->mEntries[{start, end}] = { cost, std::vector<MotionRun>(runs.begin(), runs.end()) };
+	}
+
+	void PathCache::Clear()
+	{
+		this->mEntries.clear();
+		this->mObstacles.clear();
+	}
+
+	std::size_t PathCache::Size() const
+	{
+		return this->mEntries.size();
+	}
+
+	int LegTable::Intern(const ObjectState& s)
+	{
+		auto [it, inserted] = this->mIds.try_emplace(s.Key(), static_cast<int>(this->mIds.size()));
+		if (!inserted)
+			return it->second;
+		this->mPoses.push_back(ObjectState(s.m_location, s.m_Fd));
+		if (this->mIds.size() > this->mStride)
+			this->Grow(std::max<std::size_t>(this->mStride * 2, 64));
+		return it->second;
+	}
+
+	int LegTable::Find(const ObjectState& s) const
+	{
+		auto it = this->mIds.find(s.Key());
+		return it != this->mIds.end() ? it->second : -1;
+	}
+
+	int LegTable::Cost(int from, int to) const
+	{
+		return this->mCost[from * this->mStride + to];
+	}
+
+	bool LegTable::Has(const ObjectState& start, const ObjectState& end) const
+	{
+		int from = this->Find(start), to = this->Find(end);
+		return from >= 0 && to >= 0 && this->Cost(from, to) != TSP::UNREACHABLE;
+	}
+
+	void LegTable::Store(const ObjectState& start, const ObjectState& end, int cost, std::span<const MotionRun> runs)
+	{
+		int from = this->Intern(start), to = this->Intern(end);
+		LegRef leg{ static_cast<uint32_t>(this->mRuns.size()), static_cast<uint32_t>(runs.size()), false };
+		this->mRuns.insert(this->mRuns.end(), runs.begin(), runs.end());
+		this->mCost[to * this->mStride + from] = cost;
+		this->mLegs[to * this->mStride + from] = { leg.first, leg.count, true };
+		//written last, a leg from a pose to itself stays forward
+		this->mCost[from * this->mStride + to] = cost;
+		this->mLegs[from * this->mStride + to] = leg;
+	}
+
+	std::span<const MotionRun> LegTable::Runs(int from, int to) const
+	{
+		auto& leg = this->mLegs[from * this->mStride + to];
+		return { this->mRuns.data() + leg.first, leg.count };
+	}
+
+	std::size_t LegTable::Steps(int from, int to) const
+	{
+		std::size_t steps = 0;
+		for (auto& run : this->Runs(from, to))
+			steps += run.count;
+		return steps;
+	}
+
+	std::size_t LegTable::Expand(int from, int to, const MotionTable& motions, std::vector<ObjectState>& out) const
+	{
+		auto& leg = this->mLegs[from * this->mStride + to];
+		std::size_t mark = out.size();
+		auto& start = this->mPoses[leg.reversed ? to : from];
+		auto runs = this->Runs(from, to);
+		//a reversed leg is walked from its searched start, then flipped in place
+		if (leg.reversed)
+			out.push_back(start);
+		WalkRuns(start, runs.data(), runs.size(), motions, [&out](const ObjectState& s) {
+			out.push_back(s);
+		});
+		if (leg.reversed) {
+			out.pop_back();
+			std::reverse(out.begin() + mark, out.end());
+		}
+		return out.size() - mark;
+	}
+
+	//ids stay valid, only the legs are dropped
+	void LegTable::Clear()
+	{
+		std::fill(this->mCost.begin(), this->mCost.end(), TSP::UNREACHABLE);
+		std::fill(this->mLegs.begin(), this->mLegs.end(), LegRef());
+		this->mRuns.clear();
+	}
+
+	void LegTable::Grow(std::size_t poses)
+	{
+		std::vector<int> cost(poses * poses, TSP::UNREACHABLE);
+		std::vector<LegRef> legs(poses * poses);
+		for (std::size_t from = 0; from < this->mStride; from++)
+		{
+			for (std::size_t to = 0; to < this->mStride; to++)
+			{
+				cost[from * poses + to] = this->mCost[from * this->mStride + to];
+				legs[from * poses + to] = this->mLegs[from * this->mStride + to];
+			}
+		}
+		this->mCost = std::move(cost);
+		this->mLegs = std::move(legs);
+		this->mStride = poses;
+	}
+
+	//An obstacle only changes the clearance/safe cost of cells within manhattan 4 of it.
+	//A new obstacle can only break legs that pass through those cells. A removed one can
+	//only make a leg cheaper by passing through them, which costs at least the scaled
+	//manhattan distance to get there and back, so legs already cheaper than that stay.
+	void PathCache::Sync(const std::vector<Point>& obstacles, const std::vector<int>& signature, double move_scale,
+		const MotionTable& motions)
+	{
+		if (signature != this->mSignature) {
+			this->Clear();
+			this->mSignature = signature;
+			this->mObstacles = obstacles;
+			return;
+		}
+		auto same = [](const Point& l, const Point& r) { return l.x == r.x && l.y == r.y; };
+		auto difference = [&same](const std::vector<Point>& from, std::vector<Point> other) {
+			std::vector<Point> result;
+			for (auto& p : from) {
+				auto it = std::find_if(other.begin(), other.end(), [&](const Point& o) { return same(p, o); });
+				if (it == other.end())
+					result.push_back(p);
+				else
+					other.erase(it);
+			}
+			return result;
+		};
+		auto added = difference(obstacles, this->mObstacles);
+		auto removed = difference(this->mObstacles, obstacles);
+		this->mObstacles = obstacles;
+		if (added.empty() && removed.empty())
+			return;
+
+		auto manhattan = [](const Point& a, const Point& b) {
+			return static_cast<int>(abs(a.x - b.x) + abs(a.y - b.y));
+		};
+		for (auto it = this->mEntries.begin(); it != this->mEntries.end();)
+		{
+			bool invalid = false;
+			auto& runs = it->second.runs;
+			auto near_added = [&](const ObjectState& s) {
+				for (auto& o : added)
+					invalid = invalid || manhattan(s.m_location, o) <= 4;
+			};
+			if (!added.empty()) {
+				near_added(it->first.Start);
+				WalkRuns(it->first.Start, runs.data(), runs.size(), motions, near_added);
+			}
+			for (std::size_t i = 0; !invalid && i < removed.size(); i++) {
+				auto& o = removed[i];
+				int detour = std::max(0, manhattan(it->first.Start.m_location, o) - 4) +
+					std::max(0, manhattan(o, it->first.End.m_location) - 4);
+				if (it->second.cost > static_cast<int>(detour * move_scale))
+					invalid = true;
+			}
+			if (invalid)
+				it = this->mEntries.erase(it);
+			else
+				++it;
+		}
+	}
+
+	MazeSolver::MazeSolver(const Point& grid_size, const Point& robot, FaceDirection robot_dir,
 		bool big_turn) : mGrid(grid_size),
 		mRobot(std::make_shared<FieldRobot>(robot, robot_dir)),
 		mBigTurn(big_turn), turn_wrt_big_turns{
@@ -165,36 +438,138 @@ namespace MDP {
 			{4 * Config::get().Get_TURN_RADIUS(), 2 * Config::get().Get_TURN_RADIUS()},
 		}
 	{
+		this->SelectMotions();
 	}
 
-	MazeSolver& MazeSolver::AddObstacle(const POINT& loc, FaceDirection dir)
+	MazeSolver& MazeSolver::AddObstacle(const Point& loc, FaceDirection dir)
 	{
 		this->mGrid.AddObstacle(loc, dir);
+		//legs searched before this obstacle may now run through it
+		this->mLegs.Clear();
+		this->RepairTrees(loc);
 		return *this;
 	}
 
 	MazeSolver& MazeSolver::AddObstacle(const SFieldObject& obj)
 	{
 		this->mGrid.AddObstacle(obj);
+		this->mLegs.Clear();
+		this->RepairTrees(obj->GetLoc());
+		return *this;
+	}
+
+	MazeSolver& MazeSolver::UpdateRobot(const Point& loc, FaceDirection dir)
+	{
+		this->mRobot->Update(loc, dir);
 		return *this;
 	}
 
+	void MazeSolver::EnableIncrementalSearch(bool enable)
+	{
+		this->mIncremental = enable;
+		if (!enable)
+			this->mTrees.clear();
+	}
+
 	std::vector<SFieldObject> MazeSolver::GetObstacles() const
 	{
 		return this->mGrid.GetObjects();
 	}
 
+	const SolveStats& MazeSolver::GetStats() const
+	{
+		return this->mStats;
+	}
+
+	void MazeSolver::SetPathCache(const std::shared_ptr<PathCache>& cache)
+	{
+		this->mPathCache = cache;
+	}
+
+	void MazeSolver::SetProgressCallback(const ProgressCallback& callback)
+	{
+		this->mProgress = callback;
+	}
+
+	void MazeSolver::Cancel()
+	{
+		this->mCancelled.store(true, std::memory_order_relaxed);
+	}
+
+	bool MazeSolver::IsCancelled() const
+	{
+		return this->mCancelled.load(std::memory_order_relaxed);
+	}
+
+	bool MazeSolver::Expired(Deadline deadline) const
+	{
+		return this->IsCancelled() ||
+			(deadline != Deadline::max() && std::chrono::steady_clock::now() >= deadline);
+	}
+
+	void MazeSolver::ReportProgress(std::size_t subset, std::size_t subsets, const char* stage,
+		std::size_t done, std::size_t total)
+	{
+		if (this->mProgress)
+			this->mProgress({ subset, subsets, stage, done, total });
+	}
+
+	void MazeSolver::SyncPathCache()
+	{
+		if (!this->mPathCache)
+			return;
+		std::vector<Point> obstacles;
+		for (auto& obj : this->mGrid.GetObjects())
+			obstacles.push_back(obj->GetLoc());
+		auto& turn = this->turn_wrt_big_turns[this->mBigTurn];
+		//everything a leg's cost depends on besides the obstacles
+		std::vector<int> signature{
+			static_cast<int>(this->mGrid.GetSize().x), static_cast<int>(this->mGrid.GetSize().y),
+			turn.left_wheel, turn.right_wheel,
+			Config::get().Get_EXPANDED_CELL(), Config::get().Get_SAFE_COST(), Config::get().Get_TURN_FACTOR(),
+		};
+		//cheapest cost per cell of displacement: 1 going straight, a 90 degree turn costs
+		//rotation + 1 + 10 for left + right cells
+		double turn_scale = (2.0 * Config::get().Get_TURN_FACTOR() + 11) / (turn.left_wheel + turn.right_wheel);
+		this->mPathCache->Sync(obstacles, signature, std::min(1.0, turn_scale), this->mMotions);
+	}
+
+	bool MazeSolver::LoadCachedPath(const ObjectState& start, const ObjectState& end)
+	{
+		if (!this->mPathCache)
+			return false;
+		auto* entry = this->mPathCache->Find(start, end);
+		if (!entry)
+			return false;
+		this->mLegs.Store(start, end, entry->cost, entry->runs);
+		SOLVER_STAT(this->mStats.path_cache_hits++);
+		return true;
+	}
+
 	std::vector<ObjectState> MazeSolver::GetOptimalOrderDP(bool retrying)
 	{
 		std::vector<ObjectState> optimal_path;
 		int distance = 0x7FFFFFFF;
+		this->mStats = SolveStats();
+		//every search array is indexed by the robot's pose, off the grid there is nothing to solve
+		if (!this->mGrid.FitsPoseKeys() || !this->mGrid.Contains(this->mRobot->GetState().m_location))
+			return optimal_path;
+		Utils::Arena::Scope scratch(this->mArena);
+		auto* memory = this->mArena.Resource();
+		SOLVER_STAT(std::size_t reachable_calls = this->mGrid.GetReachableCalls());
+		this->SyncPathCache();
+		SOLVER_STAT(Utils::Stopwatch watch);
 		auto all_pos = this->mGrid.GetViewObstaclePositions(retrying);
+		this->DropUnreachablePoses(all_pos);
 		//std::cout << "all_pos:" << all_pos.size() << std::endl;
 
 		//auto visit_options = ;
 		//std::cout << "visit_options:" << visit_options << std::endl;
-		for (auto& op : GetVisitOptions(all_pos.size()))
+		auto visit_options = GetVisitOptions(all_pos.size());
+		auto cancelled = [this]() { return this->IsCancelled(); };
+		for (std::size_t subset = 0; subset < visit_options.size(); subset++)
 		{
+			int op = visit_options[subset];
 			std::vector<ObjectState> items { this->mRobot->GetState() };
 			std::vector<std::vector<ObjectState>> CurViewPos;
 			for (std::size_t i = 0; i < all_pos.size(); i++)
@@ -214,298 +589,811 @@ namespace MDP {
 				std::cout << "[vp]" << vp << std::endl;
 			}*/
 			//std::cout << "[CurViewPos]" << CurViewPos.size() << std::endl;
-			this->GeneratePathCost(items);
-			std::vector<int> current;
-			std::vector<std::vector<int>> combination;
+			SOLVER_STAT(this->mStats.view_pose_ms += watch.Lap());
+			SOLVER_STAT(this->mStats.subsets_tried++);
+			auto ids = this->InternPoses(items);
+			if (!this->GeneratePathCost(items, Deadline::max(), subset, visit_options.size()))
+				break;
+			this->BuildCostMatrix(ids);
+			SOLVER_STAT(this->mStats.path_cost_ms += watch.Lap());
+			if (Config::get().Is_GeneralizedTSP())
+			{
+				std::vector<int> order;
+				if (this->mTSP.empty())
+					this->mTSP.resize(1);
+				this->mTSP[0].set_interrupt(cancelled);
+				this->ReportProgress(subset, visit_options.size(), "tsp", 0, 1);
+				int total = this->SolveGrouped(CurViewPos, order);
+				if (this->IsCancelled())
+					break;
+				this->ReportProgress(subset, visit_options.size(), "tsp", 1, 1);
+				SOLVER_STAT(this->mStats.tsp_calls++);
+				SOLVER_STAT(this->mStats.tsp_ms += watch.Lap());
+				if (total < distance) {
+					distance = total;
+					this->AssemblePath(items, ids, order, optimal_path);
+					SOLVER_STAT(this->mStats.assembly_ms += watch.Lap());
+					break;
+				}
+				continue;
+			}
+			std::pmr::vector<int> current(memory);
+			std::pmr::vector<std::pmr::vector<int>> combination(memory);
 			std::size_t iterations = Config::get().Get_ITERATIONS();
 			this->GenerateCombination(CurViewPos, 0, current, combination, iterations);
 			//std::cout << "[combination]" << combination.size() << std::endl;
-			for (auto& c : combination)
+			//bound every combination first and evaluate the most promising ones first,
+			//so a strong incumbent prunes the rest before their TSP runs
+			std::pmr::vector<std::pmr::vector<int>> candidates(combination.size(), memory);
+			std::pmr::vector<int> fixed_cost(combination.size(), memory), bound(combination.size(), memory);
+			for (std::size_t index = 0; index < combination.size(); index++) {
+				fixed_cost[index] = this->BuildCandidates(combination[index], CurViewPos, candidates[index]);
+				int tour_bound = this->CombinationBound(candidates[index]);
+				bound[index] = tour_bound == TSP::UNREACHABLE ? TSP::UNREACHABLE : tour_bound + fixed_cost[index];
+			}
+			std::pmr::vector<std::size_t> eval_order(combination.size(), memory);
+			for (std::size_t index = 0; index < eval_order.size(); index++)
+				eval_order[index] = index;
+			std::stable_sort(eval_order.begin(), eval_order.end(), [&bound](std::size_t l, std::size_t r) {
+				return bound[l] < bound[r];
+			});
+
+			struct WorkerBest {
+				uint64_t key = ~uint64_t(0);
+				std::vector<int> permutation;
+				std::size_t evaluated = 0;
+				std::size_t pruned = 0;
+			};
+			//(cost, combination index) packed so that the smallest key is the sequential winner:
+			//lowest cost, then lowest combination index
+			auto make_key = [](int cost, std::size_t index) {
+				return (static_cast<uint64_t>(cost) << 32) | static_cast<uint64_t>(index);
+			};
+			std::atomic<uint64_t> incumbent{ ~uint64_t(0) };
+			std::size_t chunk = 16;
+			std::size_t workers = Config::get().Get_THREADS() > 0 ? Config::get().Get_THREADS() :
+				std::max(1u, std::thread::hardware_concurrency());
+			workers = std::min(workers, (combination.size() + chunk - 1) / chunk);
+			workers = std::max(workers, std::size_t(1));
+			if (this->mTSP.size() < workers)
+				this->mTSP.resize(workers);
+			for (auto& tsp : this->mTSP)
+				tsp.set_interrupt(cancelled);
+			std::vector<WorkerBest> best(workers);
+			SOLVER_STAT(this->mStats.combinations_enumerated += combination.size());
+			SOLVER_STAT(this->mStats.combination_ms += watch.Lap());
+			std::atomic<std::size_t> processed{ 0 };
+			auto count_processed = [&]() {
+				std::size_t done = processed.fetch_add(1, std::memory_order_relaxed) + 1;
+				if (done % chunk == 0 || done == eval_order.size())
+					this->ReportProgress(subset, visit_options.size(), "combinations", done, eval_order.size());
+			};
+			this->ReportProgress(subset, visit_options.size(), "combinations", 0, eval_order.size());
+			auto evaluate = [&](std::size_t worker, std::size_t index) {
+				//the tour can't cost less than its bound, prune if it can't beat the incumbent
+				if (bound[index] == TSP::UNREACHABLE ||
+					make_key(bound[index], index) > incumbent.load(std::memory_order_relaxed)) {
+					best[worker].pruned++;
+					return;
+				}
+				best[worker].evaluated++;
+				auto& tsp = this->mTSP[worker];
+				int total = this->EvaluateCombination(candidates[index], fixed_cost[index], tsp);
+				if (total == TSP::UNREACHABLE)
+					return;
+				uint64_t key = make_key(total, index);
+				if (key < best[worker].key) {
+					best[worker].key = key;
+					best[worker].permutation = tsp.last_result().permutation;
+				}
+				uint64_t cur = incumbent.load(std::memory_order_relaxed);
+				while (key < cur && !incumbent.compare_exchange_weak(cur, key, std::memory_order_relaxed));
+			};
+			Utils::parallel_for(eval_order.size(), workers, chunk, [&](std::size_t worker, std::size_t pos) {
+				if (!this->IsCancelled())
+					evaluate(worker, eval_order[pos]);
+				count_processed();
+			});
+			if (this->IsCancelled())
+				break;
+			auto winner = std::min_element(best.begin(), best.end(), [](const WorkerBest& l, const WorkerBest& r) {
+				return l.key < r.key;
+			});
+#if SolverStats >= 1
+			for (auto& b : best) {
+				this->mStats.combinations_evaluated += b.evaluated;
+				this->mStats.combinations_pruned += b.pruned;
+				//one TSP per evaluated combination
+				this->mStats.tsp_calls += b.evaluated;
+			}
+			this->mStats.tsp_ms += watch.Lap();
+#endif
+			int winner_cost = static_cast<int>(winner->key >> 32);
+			if (winner->key != ~uint64_t(0) && winner_cost < distance)
+			{
+				auto& visited_candidates = candidates[winner->key & 0xFFFFFFFF];
+				std::vector<int> order;
+				for (auto& p : winner->permutation)
+					order.push_back(visited_candidates[p]);
+				distance = winner_cost;
+				this->AssemblePath(items, ids, order, optimal_path);
+			}
+			SOLVER_STAT(this->mStats.assembly_ms += watch.Lap());
+			if (!optimal_path.empty()) {
+				break;
+			}
+		}
+		SOLVER_STAT(this->mStats.reachable_calls = this->mGrid.GetReachableCalls() - reachable_calls);
+		SOLVER_STAT(this->mStats.scratch_overflows = this->mArena.Overflows());
+		if (this->IsCancelled())
+			optimal_path.clear();
+		return optimal_path;
+	}
+
+	//Anytime variant: a tour through the cheapest view pose of every obstacle comes first so
+	//there is an answer early, then the remaining legs are searched and tours are improved
+	//until they are optimal or deadline passes. Combinations are tried cheapest penalties
+	//first, without the ITERATIONS cap. With GeneralizedTSP the exact grouped DP runs first
+	//and the combinations are only tried when it can't finish within its share of the time.
+	//If the deadline passes while even the seed legs are searched, the path only visits the
+	//seed poses that the legs found so far connect, nearest first.
+	std::vector<ObjectState> MazeSolver::GetOptimalOrderDP(bool retrying, Deadline deadline,
+		const ImproveCallback& on_improve)
+	{
+		std::vector<ObjectState> optimal_path;
+		int distance = TSP::UNREACHABLE;
+		this->mStats = SolveStats();
+		if (!this->mGrid.FitsPoseKeys() || !this->mGrid.Contains(this->mRobot->GetState().m_location))
+			return optimal_path;
+		Utils::Arena::Scope scratch(this->mArena);
+		auto* memory = this->mArena.Resource();
+		SOLVER_STAT(std::size_t reachable_calls = this->mGrid.GetReachableCalls());
+		this->SyncPathCache();
+		SOLVER_STAT(Utils::Stopwatch watch);
+		if (this->mTSP.empty())
+			this->mTSP.resize(1);
+		auto& tsp = this->mTSP[0];
+		auto expired = [this, &deadline]() { return this->Expired(deadline); };
+		auto all_pos = this->mGrid.GetViewObstaclePositions(retrying);
+		this->DropUnreachablePoses(all_pos);
+		auto visit_options = GetVisitOptions(all_pos.size());
+		//the incumbent is only its visiting order, the loop leaves on the subset it belongs to
+		//so items and ids still describe it afterwards
+		std::vector<ObjectState> items;
+		std::vector<int> ids, best_order;
+		bool found = false;
+		for (std::size_t subset = 0; subset < visit_options.size(); subset++)
+		{
+			int op = visit_options[subset];
+			items = { this->mRobot->GetState() };
+			std::vector<std::vector<ObjectState>> CurViewPos;
+			bool viewable = true;
+			for (std::size_t i = 0; i < all_pos.size(); i++)
 			{
-				std::vector<int> visited_candidates{0};
-				std::size_t cur_index = 1;
-				int fixed_cost = 0;
-				for (std::size_t index = 0; index < CurViewPos.size(); index++) 
+				if ((op >> i) & 1)
 				{
-					auto& view_pos = CurViewPos[index];
-					visited_candidates.push_back(cur_index + c[index]);
-					fixed_cost += view_pos[c[index]].penalty;
-					cur_index += view_pos.size();
+					std::copy(all_pos[i].begin(), all_pos[i].end(), std::back_inserter(items));
+					CurViewPos.push_back(all_pos[i]);
+					viewable = viewable && !all_pos[i].empty();
 				}
-				//std::cout << "[visited_candidates]" << visited_candidates << std::endl;
-				//std::cout << "[CurViewPos]" << CurViewPos.size() << std::endl;
-				std::vector<std::vector<int>> cost_np;
-				cost_np.resize(visited_candidates.size());
-				for (auto& row : cost_np) row.resize(visited_candidates.size());
-				for (std::size_t y = 0; y < visited_candidates.size(); y++)
-				{
-					for (std::size_t x = y + 1; x < visited_candidates.size(); x++)
-					{
-						ObjectState u = items[visited_candidates[y]];
-						ObjectState v = items[visited_candidates[x]];
-						if (this->cost_table.find({ u , v }) != this->cost_table.end())
-							cost_np[y][x] = this->cost_table[{u, v}];
-						else
-							cost_np[y][x] = 0x7FFFFFFF;
-						cost_np[x][y] = cost_np[y][x];
-					}
+			}
+			if (!viewable)
+				continue;
+			SOLVER_STAT(this->mStats.view_pose_ms += watch.Lap());
+			SOLVER_STAT(this->mStats.subsets_tried++);
+			ids = this->InternPoses(items);
+
+			auto improve = [&](const std::vector<int>& order, int total) {
+				distance = total;
+				best_order = order;
+				found = true;
+				//states are only built for the caller, the search itself never needs them
+				if (on_improve) {
+					this->AssemblePath(items, ids, best_order, optimal_path);
+					SOLVER_STAT(this->mStats.assembly_ms += watch.Lap());
+					on_improve(optimal_path, total);
+					//the caller's time is no phase of the solve
+					SOLVER_STAT(watch.Lap());
 				}
-				for (std::size_t y = 0; y < cost_np.size(); y++) {
-					/*for (std::size_t x = 0; x < cost_np[y].size(); x++) {
-						std::cout << "y(" << y << ", " << x << "): " << cost_np[y][x] << std::endl;
-					}*/
-					cost_np[y][0] = 0;
+			};
+			auto try_combination = [&](std::span<const int> c) {
+				std::pmr::vector<int> candidates(memory);
+				int fixed_cost = this->BuildCandidates(c, CurViewPos, candidates);
+				int bound = this->CombinationBound(candidates);
+				SOLVER_STAT(this->mStats.combination_ms += watch.Lap());
+				if (bound == TSP::UNREACHABLE || bound + fixed_cost >= distance) {
+					SOLVER_STAT(this->mStats.combinations_pruned++);
+					return;
 				}
-				//std::cout << "Before TSP.solve" << std::endl;
-				auto result = TSP::solve(cost_np);
-				//std::cout << "TSP.solve dist: " << result.best_distance << std::endl;
-				//std::cout << "fixed_cost: " << fixed_cost << std::endl;
-				if (result.best_distance + fixed_cost >= distance)
-					continue;
-				//std::cout << "result.permutation: " << result.permutation.size() << result.permutation << std::endl;
-				optimal_path = { items[0] };
-				distance = result.best_distance + fixed_cost;
-				for (std::size_t i = 0; i < result.permutation.size() - 1; i++)
-				{
-					auto& from_item = items[visited_candidates[result.permutation[i]]];
-					auto& to_item = items[visited_candidates[result.permutation[i + 1]]];
+				SOLVER_STAT(this->mStats.combinations_evaluated++);
+				SOLVER_STAT(this->mStats.tsp_calls++);
+				int total = this->EvaluateCombination(candidates, fixed_cost, tsp);
+				SOLVER_STAT(this->mStats.tsp_ms += watch.Lap());
+				if (total >= distance)
+					return;
+				std::vector<int> order;
+				for (auto& p : tsp.last_result().permutation)
+					order.push_back(candidates[p]);
+				improve(order, total);
+			};
+
+			//view poses of every obstacle by penalty, cheapest first
+			std::pmr::vector<std::pmr::vector<int>> ranks(CurViewPos.size(), memory);
+			for (std::size_t g = 0; g < CurViewPos.size(); g++)
+			{
+				for (std::size_t p = 0; p < CurViewPos[g].size(); p++)
+					ranks[g].push_back(static_cast<int>(p));
+				std::stable_sort(ranks[g].begin(), ranks[g].end(), [&CurViewPos, g](int l, int r) {
+					return CurViewPos[g][l].penalty < CurViewPos[g][r].penalty;
+				});
+			}
+			auto to_combination = [&ranks, memory](std::span<const int> rank) {
+				std::pmr::vector<int> c(rank.size(), memory);
+				for (std::size_t g = 0; g < rank.size(); g++)
+					c[g] = ranks[g][rank[g]];
+				return c;
+			};
+
+			//seed: only the legs between the robot and the cheapest poses are searched
+			std::pmr::vector<int> seed_rank(CurViewPos.size(), 0, memory);
+			std::vector<ObjectState> seed_items{ items[0] };
+			for (std::size_t g = 0; g < CurViewPos.size(); g++)
+				seed_items.push_back(CurViewPos[g][ranks[g][0]]);
+			if (!this->GeneratePathCost(seed_items, deadline, subset, visit_options.size()))
+			{
+				std::pmr::vector<int> candidates(memory);
+				this->BuildCandidates(to_combination(seed_rank), CurViewPos, candidates);
+				std::vector<int> order;
+				int total = this->GreedyOrder(candidates, items, ids, order);
+				SOLVER_STAT(this->mStats.path_cost_ms += watch.Lap());
+				if (order.size() > 1)
+					improve(order, total);
+				break;
+			}
+			this->BuildCostMatrix(ids);
+			SOLVER_STAT(this->mStats.path_cost_ms += watch.Lap());
+			try_combination(to_combination(seed_rank));
+
+			//filled again now that the legs off the seed tour are known as well
+			if (!this->GeneratePathCost(items, deadline, subset, visit_options.size()))
+			{
+				SOLVER_STAT(this->mStats.path_cost_ms += watch.Lap());
+				break;
+			}
+			this->BuildCostMatrix(ids);
+			SOLVER_STAT(this->mStats.path_cost_ms += watch.Lap());
 
-					auto cur_path = this->path_table[{from_item, to_item}];
-					for (std::size_t j = 1; j < cur_path.size(); j++)
+			//the grouped DP only answers once it has finished, so it gets half of the time left
+			//and the best-first enumeration below improves on the seed with the rest if it runs out
+			bool exact = false;
+			if (Config::get().Is_GeneralizedTSP())
+			{
+				auto now = std::chrono::steady_clock::now();
+				Deadline dp_deadline = deadline == Deadline::max() || deadline <= now ? deadline :
+					now + (deadline - now) / 2;
+				tsp.set_interrupt([this, dp_deadline]() { return this->Expired(dp_deadline); });
+				std::vector<int> order;
+				int total = this->SolveGrouped(CurViewPos, order);
+				tsp.set_interrupt(nullptr);
+				SOLVER_STAT(this->mStats.tsp_calls++);
+				SOLVER_STAT(this->mStats.tsp_ms += watch.Lap());
+				//an abandoned DP comes back UNREACHABLE, a finished one may too when no tour exists
+				exact = total != TSP::UNREACHABLE || !this->Expired(dp_deadline);
+				if (total < distance)
+					improve(order, total);
+			}
+			if (!exact)
+			{
+				//every combination exactly once in order of total penalty: a child bumps one
+				//obstacle at or after the one its parent bumped to its next cheapest pose
+				struct Node {
+					int fixed_cost;
+					std::size_t sequence;
+					std::pmr::vector<int> rank;
+					std::size_t next;
+					bool operator>(const Node& rhs) const {
+						return std::tie(this->fixed_cost, this->sequence) > std::tie(rhs.fixed_cost, rhs.sequence);
+					}
+				};
+				auto penalty = [&](std::size_t g, int rank) {
+					return CurViewPos[g][ranks[g][rank]].penalty;
+				};
+				int seed_cost = 0;
+				for (std::size_t g = 0; g < CurViewPos.size(); g++)
+					seed_cost += penalty(g, 0);
+				std::size_t sequence = 0;
+				std::pmr::vector<Node> open(memory);
+				open.push_back({ seed_cost, sequence++, seed_rank, 0 });
+				while (!open.empty() && !expired())
+				{
+					std::pop_heap(open.begin(), open.end(), std::greater<Node>());
+					Node node = std::move(open.back());
+					open.pop_back();
+					//penalties alone already cost as much as the incumbent, so does everything after
+					if (node.fixed_cost >= distance)
+						break;
+					SOLVER_STAT(this->mStats.combinations_enumerated++);
+					if (node.sequence != 0)
+						try_combination(to_combination(node.rank));
+					for (std::size_t g = node.next; g < node.rank.size(); g++)
 					{
-						optimal_path.push_back(cur_path[j]);
+						if (node.rank[g] + 1 >= static_cast<int>(ranks[g].size()))
+							continue;
+						Node child{ node.fixed_cost - penalty(g, node.rank[g]) + penalty(g, node.rank[g] + 1),
+							sequence++, std::pmr::vector<int>(node.rank, memory), g };
+						child.rank[g]++;
+						open.push_back(std::move(child));
+						std::push_heap(open.begin(), open.end(), std::greater<Node>());
 					}
 				}
+				SOLVER_STAT(this->mStats.combination_ms += watch.Lap());
 			}
-			if (!optimal_path.empty()) {
+			if (found || expired())
 				break;
-			}
 		}
+		if (found && !on_improve)
+			this->AssemblePath(items, ids, best_order, optimal_path);
+		SOLVER_STAT(this->mStats.assembly_ms += watch.Lap());
+		SOLVER_STAT(this->mStats.reachable_calls = this->mGrid.GetReachableCalls() - reachable_calls);
+		SOLVER_STAT(this->mStats.scratch_overflows = this->mArena.Overflows());
+		if (this->IsCancelled())
+			optimal_path.clear();
 		return optimal_path;
 	}
 
-	void MazeSolver::GeneratePathCost(const std::vector<ObjectState>& states)
+	//One flood over the (x, y, direction) lattice from the robot. A view pose it doesn't reach
+	//is on no tour, and an obstacle left without poses would only fail every subset holding
+	//it, so the subset search starts at the obstacles that can actually be visited.
+	void MazeSolver::DropUnreachablePoses(std::vector<std::vector<ObjectState>>& all_pos)
 	{
-		for (std::size_t i = 0; i < states.size() - 1; i++) 
+		auto& ss = this->mSearch;
+		//a robot off the grid has no state to flood from and reaches nothing
+		if (!this->mGrid.Contains(this->mRobot->GetState().m_location)) {
+			SOLVER_STAT(this->mStats.unreachable_obstacles = all_pos.size());
+			all_pos.clear();
+			return;
+		}
+		this->BeginSearch();
+		std::vector<int> frontier{ this->StateIndex(this->mRobot->GetState()) };
+		ss.seen[frontier[0]] = ss.generation;
+		for (std::size_t head = 0; head < frontier.size(); head++)
 		{
-			for (std::size_t j = i + 1; j < states.size(); j++) 
-			{
-				this->DoAStarSearch(states[i], states[j]);
+			this->ForEachNeighbor(this->IndexState(frontier[head]), [&](const Neighbor& n) {
+				int index = this->StateIndex(n);
+				if (ss.seen[index] == ss.generation)
+					return;
+				ss.seen[index] = ss.generation;
+				frontier.push_back(index);
+			});
+		}
+		SOLVER_STAT(std::size_t obstacles = all_pos.size());
+		for (auto& view_pos : all_pos)
+		{
+			view_pos.erase(std::remove_if(view_pos.begin(), view_pos.end(), [&](const ObjectState& s) {
+				return ss.seen[this->StateIndex(s)] != ss.generation;
+			}), view_pos.end());
+		}
+		all_pos.erase(std::remove_if(all_pos.begin(), all_pos.end(), [](const std::vector<ObjectState>& view_pos) {
+			return view_pos.empty();
+		}), all_pos.end());
+		SOLVER_STAT(this->mStats.unreachable_obstacles = obstacles - all_pos.size());
+	}
+
+	std::vector<int> MazeSolver::InternPoses(const std::vector<ObjectState>& items)
+	{
+		std::vector<int> ids;
+		ids.reserve(items.size());
+		for (auto& s : items)
+			ids.push_back(this->mLegs.Intern(s));
+		return ids;
+	}
+
+	//Copies the legs between the subset's poses out of the LegTable once, so the bound and
+	//TSP of every combination read one small block instead of rows strided over every pose
+	//ever interned. Returning to the robot is free, so column 0 is zero.
+	void MazeSolver::BuildCostMatrix(const std::vector<int>& ids)
+	{
+		int n = static_cast<int>(ids.size());
+		this->mCosts.resize(n);
+		for (int y = 0; y < n; y++)
+		{
+			int* row = this->mCosts[y];
+			for (int x = 0; x < n; x++)
+				row[x] = x == 0 || x == y ? 0 : this->mLegs.Cost(ids[y], ids[x]);
+		}
+	}
+
+	int MazeSolver::SolveGrouped(const std::vector<std::vector<ObjectState>>& view_pos, std::vector<int>& order)
+	{
+		//mCosts rows are the robot followed by the view poses of every obstacle in view_pos order
+		std::pmr::vector<int> group(1, -1, this->mArena.Resource()), penalty(1, 0, this->mArena.Resource());
+		for (std::size_t index = 0; index < view_pos.size(); index++)
+		{
+			for (auto& s : view_pos[index]) {
+				group.push_back(static_cast<int>(index));
+				penalty.push_back(s.penalty);
 			}
 		}
+		if (this->mTSP.empty())
+			this->mTSP.resize(1);
+		auto& result = this->mTSP[0].solve_grouped(this->mCosts, group, penalty, static_cast<int>(view_pos.size()));
+		order = result.permutation;
+		return result.best_distance;
 	}
 
-	void MazeSolver::DoAStarSearch(const ObjectState& start, const ObjectState& end)
+	void MazeSolver::AssemblePath(const std::vector<ObjectState>& items, const std::vector<int>& ids,
+		const std::vector<int>& order, std::vector<ObjectState>& optimal_path)
 	{
-		struct temp_heap_struct : ObjectState {
-			int f_distance;
+		//sized up front from the run lengths, so the legs stream in without reallocating
+		std::size_t states = 1;
+		for (std::size_t i = 0; i + 1 < order.size(); i++)
+			states += this->mLegs.Steps(ids[order[i]], ids[order[i + 1]]);
+		optimal_path.clear();
+		optimal_path.reserve(states);
+		optimal_path.push_back(items[0]);
+		for (std::size_t i = 0; i + 1 < order.size(); i++)
+		{
+			auto& to_item = items[order[i + 1]];
+
+			//only the winning tour's legs are ever expanded to states
+			std::size_t steps = this->mLegs.Expand(ids[order[i]], ids[order[i + 1]], this->mMotions, optimal_path);
+			//view poses shared by two obstacles share an id, end on the
+			//candidate the tour actually picked so its snapshot id is kept
+			if (steps > 0)
+				optimal_path.back() = to_item;
+		}
+	}
 
-			temp_heap_struct(const ObjectState& s, int f_distance = 0) :
-				ObjectState(s), f_distance(f_distance)
+	//order[0] is the robot, then repeatedly the nearest visited candidate the legs searched so
+	//far reach from the last pose, until none is left or reachable. Returns the legs' cost plus
+	//the penalties of the poses visited.
+	int MazeSolver::GreedyOrder(std::span<const int> visited_candidates, const std::vector<ObjectState>& items,
+		const std::vector<int>& ids, std::vector<int>& order)
+	{
+		std::vector<bool> visited(visited_candidates.size(), false);
+		order.assign(1, visited_candidates[0]);
+		int total = 0;
+		while (true)
+		{
+			std::size_t next = 0;
+			int best = TSP::UNREACHABLE;
+			for (std::size_t i = 1; i < visited_candidates.size(); i++)
 			{
+				if (visited[i])
+					continue;
+				int cost = this->mLegs.Cost(ids[order.back()], ids[visited_candidates[i]]);
+				if (cost < best) {
+					best = cost;
+					next = i;
+				}
 			}
+			if (next == 0)
+				return total;
+			visited[next] = true;
+			order.push_back(visited_candidates[next]);
+			total += best + items[visited_candidates[next]].penalty;
+		}
+	}
 
-			bool operator<(const temp_heap_struct& rhs) const
-			{
-				if (this->f_distance < rhs.f_distance)
-					return true;
-				else if (this->f_distance > rhs.f_distance)
-					return false;
+	int MazeSolver::BuildCandidates(std::span<const int> c, const std::vector<std::vector<ObjectState>>& view_pos,
+		std::pmr::vector<int>& visited_candidates)
+	{
+		visited_candidates.assign(1, 0);
+		std::size_t cur_index = 1;
+		int fixed_cost = 0;
+		for (std::size_t index = 0; index < view_pos.size(); index++) 
+		{
+			visited_candidates.push_back(cur_index + c[index]);
+			fixed_cost += view_pos[index][c[index]].penalty;
+			cur_index += view_pos[index].size();
+		}
+		return fixed_cost;
+	}
 
-				if (this->m_location.x < rhs.m_location.x)
-					return true;
-				else if (this->m_location.x > rhs.m_location.x)
-					return true;
+	//The tour is a path from the robot through every candidate (returning is free),
+	//which is a spanning tree, so the MST weight is an admissible lower bound.
+	int MazeSolver::CombinationBound(std::span<const int> visited_candidates)
+	{
+		std::size_t n = visited_candidates.size();
+		std::pmr::vector<int> key(n, TSP::UNREACHABLE, this->mArena.Resource());
+		std::pmr::vector<bool> in_tree(n, false, this->mArena.Resource());
+		key[0] = 0;
+		int total = 0;
+		for (std::size_t step = 0; step < n; step++)
+		{
+			std::size_t u = n;
+			for (std::size_t v = 0; v < n; v++) {
+				if (!in_tree[v] && (u == n || key[v] < key[u]))
+					u = v;
+			}
+			if (key[u] == TSP::UNREACHABLE)
+				return TSP::UNREACHABLE;
+			in_tree[u] = true;
+			total += key[u];
+			const int* row = this->mCosts[visited_candidates[u]];
+			for (std::size_t v = 0; v < n; v++) {
+				if (in_tree[v])
+					continue;
+				int cost = row[visited_candidates[v]];
+				if (cost < key[v])
+					key[v] = cost;
+			}
+		}
+		return total;
+	}
 
-				if (this->m_location.y < rhs.m_location.y)
-					return true;
-				else if (this->m_location.y > rhs.m_location.y)
-					return false;
-				
+	int MazeSolver::EvaluateCombination(std::span<const int> visited_candidates, int fixed_cost, TSP::Solver& tsp)
+	{
+		auto& result = tsp.solve(this->mCosts, visited_candidates);
+		if (result.best_distance == TSP::UNREACHABLE)
+			return TSP::UNREACHABLE;
+		return result.best_distance + fixed_cost;
+	}
 
-				if (this->m_Fd < rhs.m_Fd)
-					return true;
+	//false when deadline passed before every leg was searched, the legs found so far stay usable
+	bool MazeSolver::GeneratePathCost(const std::vector<ObjectState>& states, Deadline deadline,
+		std::size_t subset, std::size_t subsets)
+	{
+		//one step per source or target, every mode searches states.size() - 1 of them
+		std::size_t steps = states.empty() ? 0 : states.size() - 1;
+		auto step = [&](std::size_t done) {
+			if (this->Expired(deadline))
 				return false;
+			this->ReportProgress(subset, subsets, "legs", done, steps);
+			return true;
+		};
+		if (this->mIncremental)
+		{
+			//every leg into states[j] is read off the tree rooted at it
+			for (std::size_t j = 1; j < states.size(); j++)
+			{
+				if (!step(j - 1))
+					return false;
+				auto& tree = this->GetTree(states[j]);
+				for (std::size_t i = 0; i < j; i++)
+				{
+					if (this->mLegs.Has(states[i], states[j]))
+						continue;
+					if (tree.g[this->StateIndex(states[i])] != TSP::UNREACHABLE)
+						this->RecordTreePath(states[i], states[j], tree);
+				}
 			}
-
-			bool operator>(const temp_heap_struct& rhs) const
+			return step(steps);
+		}
+		if (Config::get().Is_ReverseHeuristic())
+		{
+			for (std::size_t j = 1; j < states.size(); j++)
 			{
-				if (this->f_distance > rhs.f_distance)
-					return true;
-				else if (this->f_distance < rhs.f_distance)
+				if (!step(j - 1))
 					return false;
+				for (std::size_t i = 0; i < j; i++)
+					this->DoAStarSearch(states[i], states[j]);
+			}
+			return step(steps);
+		}
+		//one search per source settles every later state in a single pass
+		for (std::size_t i = 0; i < states.size() - 1; i++) 
+		{
+			if (!step(i))
+				return false;
+			this->DoMultiTargetSearch(states[i], std::span<const ObjectState>(states).subspan(i + 1));
+		}
+		return step(steps);
+	}
 
-				if (this->m_location.x > rhs.m_location.x)
-					return true;
-				else if (this->m_location.x < rhs.m_location.x)
-					return false;
+	//fixed-size row, so the loop has a constant trip count and nothing is allocated per expansion
+	template<typename Visit>
+	void MazeSolver::ForEachNeighbor(const ObjectState& s, Visit&& visit)
+	{
+		int cost = 0;
+		for (auto& m : this->mMotions[s.m_Fd - FaceDirection::FD_North])
+		{
+			if (this->CanMove(s.m_location, m, cost))
+				visit(Neighbor({ s.m_location.x + m.offset.x, s.m_location.y + m.offset.y }, m.to, cost));
+		}
+	}
 
-				if (this->m_location.y > rhs.m_location.y)
-					return true;
-				else if (this->m_location.y < rhs.m_location.y)
-					return false;
+	//edge weight of a step out of from, the forward searches and the reverse trees must agree on it
+	int MazeSolver::MoveCost(const ObjectState& from, const Neighbor& n) const
+	{
+		return rotation_cost(n.m_Fd, from.m_Fd) * Config::get().Get_TURN_FACTOR() + 1 + n.cost;
+	}
 
-				if (this->m_Fd > rhs.m_Fd)
-					return true;
-				return false;
-			}
+	void MazeSolver::DoAStarSearch(const ObjectState& start, const ObjectState& end)
+	{
+		if (this->mLegs.Has(start, end) ||
+			this->LoadCachedPath(start, end))
+			return;
+		//exact cost-to-go off the reverse tree rooted at end, shared by every leg into it
+		const std::vector<int>* reverse = Config::get().Is_ReverseHeuristic() ? &this->GetTree(end).g : nullptr;
+		auto heuristic = [&](int index, const Point& loc) {
+			return reverse ? (*reverse)[index] : compute_dist(loc.x, loc.y, end.m_location.x, end.m_location.y);
 		};
-
-		FieldStartEnd se{ start, end };
-		if (this->path_table.find(se) != this->path_table.end())
+		auto& ss = this->mSearch;
+		this->BeginSearch();
+		int start_index = this->StateIndex(start);
+		int end_index = this->StateIndex(end);
+		if (heuristic(start_index, start.m_location) == TSP::UNREACHABLE)
 			return;
-		std::priority_queue<temp_heap_struct, std::vector<temp_heap_struct>,
-			std::greater<temp_heap_struct>> pq;
-		std::set<ObjectState> visited;
-		std::unordered_map<ObjectState, int> g_distance;
-		std::unordered_map<ObjectState, ObjectState> parent;
-		g_distance[start] = 0;
-		pq.push({ start, (int)compute_dist(start.m_location.x, start.m_location.y, end.m_location.x, end.m_location.y)});
-
-		while (!pq.empty())
+		ss.g_cost[start_index] = 0;
+		ss.seen[start_index] = ss.generation;
+		ss.open.push_back({ heuristic(start_index, start.m_location), start_index });
+		SOLVER_STAT(this->mStats.searches++);
+		SOLVER_STAT(std::size_t expanded = 0);
+
+		while (!ss.open.empty())
 		{
-			auto item = pq.top();
-			pq.pop();
-			if (visited.find(item) != visited.end())
+			std::pop_heap(ss.open.begin(), ss.open.end(), std::greater<std::pair<int, int>>());
+			int cur = ss.open.back().second;
+			ss.open.pop_back();
+			if (ss.closed[cur] == ss.generation)
 				continue;
-			else if (end == ObjectState(item)) {
+			else if (cur == end_index) {
+				SOLVER_STAT(this->mStats.expansions += expanded);
+				SOLVER_STAT(this->mStats.legs.push_back({ start, end, expanded }));
 				//record path
-				return this->RecordPath(start, end, parent, g_distance[item]);
+				return this->RecordPath(start, end, ss.g_cost[cur]);
 			}
-			visited.insert(item);
-			int cur_distance = g_distance[item];
-			for (auto& n : this->GetNeighbors(item))
-			{
-				if (visited.find(n) != visited.end())
-					continue;
-				int move_cost = rotation_cost(n.m_Fd, item.m_Fd) * Config::get().Get_TURN_FACTOR() + 1 + n.cost;
-				int next_cost = cur_distance + move_cost +
-					compute_dist(n.m_location.x, n.m_location.y,
-						end.m_location.x, end.m_location.y);
-				if (g_distance.find(n) == g_distance.end() ||
-					g_distance[n] > cur_distance + move_cost) {
-					g_distance[n] = cur_distance + move_cost;
-					parent[n] = item;
-					pq.push({ n,next_cost });
+			ss.closed[cur] = ss.generation;
+			SOLVER_STAT(expanded++);
+			int cur_distance = ss.g_cost[cur];
+			auto item = this->IndexState(cur);
+			this->ForEachNeighbor(item, [&](const Neighbor& n) {
+				int next = this->StateIndex(n);
+				if (ss.closed[next] == ss.generation)
+					return;
+				int h = heuristic(next, n.m_location);
+				if (h == TSP::UNREACHABLE)
+					return;
+				int move_cost = this->MoveCost(item, n);
+				int next_cost = cur_distance + move_cost + h;
+				if (ss.seen[next] != ss.generation ||
+					ss.g_cost[next] > cur_distance + move_cost) {
+					ss.g_cost[next] = cur_distance + move_cost;
+					ss.parent[next] = cur;
+					ss.seen[next] = ss.generation;
+					ss.open.push_back({ next_cost, next });
+					std::push_heap(ss.open.begin(), ss.open.end(), std::greater<std::pair<int, int>>());
+					SOLVER_STAT(this->mStats.heap_pushes++);
 				}
-			}
+			});
 		}
 	}
 
-	std::vector<Neighbor> MazeSolver::GetNeighbors(const ObjectState& s)
+	void MazeSolver::DoMultiTargetSearch(const ObjectState& start, std::span<const ObjectState> ends)
 	{
-		std::vector<Neighbor> result;
-		for (auto& d : MOVE_DIRECTION) 
-		{
-			if (d.direction == s.m_Fd)
-			{
-				auto CheckReachableAndAppend = [this, &result](const POINT& cur, const POINT& displacement, 
-					FaceDirection d) {
-					POINT NewLoc = { cur.x + displacement.x, cur.y + displacement.y };
-					if (this->mGrid.Reachable(NewLoc)) {
-						int cost = this->GetSafeCost(NewLoc);
-						result.push_back({ NewLoc, d, cost });
-					}
-				};
-				CheckReachableAndAppend(s.m_location, d.dxdy, d.direction);
-				CheckReachableAndAppend(s.m_location, { -d.dxdy.x, -d.dxdy.y }, d.direction);
+		auto& ss = this->mSearch;
+		std::pmr::vector<ObjectState> targets(this->mArena.Resource());
+		for (auto& end : ends) {
+			if (!this->mLegs.Has(start, end) &&
+				!this->LoadCachedPath(start, end))
+				targets.push_back(end);
+		}
+		if (targets.empty())
+			return;
+		this->BeginSearch();
+		std::size_t remaining = 0;
+		for (auto& t : targets) {
+			int index = this->StateIndex(t);
+			if (ss.target[index] != ss.generation) {
+				ss.target[index] = ss.generation;
+				remaining++;
 			}
-			else
-			{
-				//consider 8 cases
-				auto CheckReachableAndAppend = [this, &result](const POINT& cur, const POINT& displacement,
-					FaceDirection d) {
-					POINT NewLoc = { cur.x + displacement.x, cur.y + displacement.y };
-					if (this->mGrid.Reachable(NewLoc, true) && this->mGrid.Reachable(cur, false, true)) {
-						int cost = this->GetSafeCost(NewLoc);
-						result.push_back({ NewLoc, d, cost + 10 });
-					}
-				};
-				int bigger_change = this->turn_wrt_big_turns[this->mBigTurn].left_wheel;
-				int smaller_change = this->turn_wrt_big_turns[this->mBigTurn].right_wheel;
-				switch (s.m_Fd)//current facing direction
-				{
-				//north > east/west
-				case FaceDirection::FD_North:
-				{
-					if (d.direction == FaceDirection::FD_East)
-					{
-						CheckReachableAndAppend(s.m_location, { bigger_change, smaller_change }, d.direction);
-						CheckReachableAndAppend(s.m_location, { -smaller_change, -bigger_change }, d.direction);
-					}
-					else if (d.direction == FaceDirection::FD_West)
-					{
-						CheckReachableAndAppend(s.m_location, { smaller_change, -bigger_change }, d.direction);
-						CheckReachableAndAppend(s.m_location, { -bigger_change, smaller_change }, d.direction);
-					}
-				}
-				break;
-				//east > north/south
-				case FaceDirection::FD_East:
-				{
-					if (d.direction == FaceDirection::FD_North)
-					{
-						CheckReachableAndAppend(s.m_location, { smaller_change, bigger_change }, d.direction);
-						CheckReachableAndAppend(s.m_location, { -bigger_change, -smaller_change }, d.direction);
-					}else if (d.direction == FaceDirection::FD_South)
-					{
-						CheckReachableAndAppend(s.m_location, { smaller_change, -bigger_change }, d.direction);
-						CheckReachableAndAppend(s.m_location, { -bigger_change, smaller_change }, d.direction);
-					}
-				}
-				break;
-				//south > east/west
-				case FaceDirection::FD_South:
-				{
-					if (d.direction == FaceDirection::FD_East)
-					{
-						CheckReachableAndAppend(s.m_location, { bigger_change, -smaller_change }, d.direction);
-						CheckReachableAndAppend(s.m_location, { -smaller_change, bigger_change }, d.direction);
-					}
-					else if (d.direction == FaceDirection::FD_West)
-					{
-						CheckReachableAndAppend(s.m_location, { -bigger_change, -smaller_change }, d.direction);
-						CheckReachableAndAppend(s.m_location, { smaller_change, bigger_change }, d.direction);
-					}
-				}
-				break;
-				//west > south/north
-				case FaceDirection::FD_West:
-				{
-					if (d.direction == FaceDirection::FD_South)
-					{
-						CheckReachableAndAppend(s.m_location, { -smaller_change, -bigger_change }, d.direction);
-						CheckReachableAndAppend(s.m_location, { bigger_change, smaller_change }, d.direction);
-					}
-					else if (d.direction == FaceDirection::FD_North)
-					{
-						CheckReachableAndAppend(s.m_location, { -smaller_change, bigger_change }, d.direction);
-						CheckReachableAndAppend(s.m_location, { bigger_change, -smaller_change }, d.direction);
+		}
+		int start_index = this->StateIndex(start);
+		ss.g_cost[start_index] = 0;
+		ss.seen[start_index] = ss.generation;
+		ss.open.push_back({ 0, start_index });
+		SOLVER_STAT(this->mStats.searches++);
+		SOLVER_STAT(std::size_t expanded = 0);
+
+		//plain dijkstra, no single goal to aim a heuristic at
+		while (!ss.open.empty())
+		{
+			std::pop_heap(ss.open.begin(), ss.open.end(), std::greater<std::pair<int, int>>());
+			int cur = ss.open.back().second;
+			ss.open.pop_back();
+			if (ss.closed[cur] == ss.generation)
+				continue;
+			ss.closed[cur] = ss.generation;
+			SOLVER_STAT(expanded++);
+			int cur_distance = ss.g_cost[cur];
+			if (ss.target[cur] == ss.generation) {
+				//a leg costs the expansions it took this search to reach it
+				for (auto& t : targets) {
+					if (this->StateIndex(t) == cur) {
+						SOLVER_STAT(this->mStats.legs.push_back({ start, t, expanded }));
+						this->RecordPath(start, t, cur_distance);
 					}
 				}
-				break;
-				}
+				if (--remaining == 0)
+					break;
 			}
+			auto item = this->IndexState(cur);
+			this->ForEachNeighbor(item, [&](const Neighbor& n) {
+				int next = this->StateIndex(n);
+				if (ss.closed[next] == ss.generation)
+					return;
+				int move_cost = this->MoveCost(item, n);
+				if (ss.seen[next] != ss.generation ||
+					ss.g_cost[next] > cur_distance + move_cost) {
+					ss.g_cost[next] = cur_distance + move_cost;
+					ss.parent[next] = cur;
+					ss.seen[next] = ss.generation;
+					ss.open.push_back({ cur_distance + move_cost, next });
+					std::push_heap(ss.open.begin(), ss.open.end(), std::greater<std::pair<int, int>>());
+					SOLVER_STAT(this->mStats.heap_pushes++);
+				}
+			});
 		}
-		return result;
+		SOLVER_STAT(this->mStats.expansions += expanded);
 	}
 
-	int MazeSolver::GetSafeCost(const POINT& xy)
+	void MazeSolver::BeginSearch()
 	{
-		for (auto& obj : this->mGrid.GetObjects())
-		{
-			if (abs(obj->GetLoc().x - xy.x) == 2 && abs(obj->GetLoc().y - xy.y) == 2)
-				return Config::get().Get_SAFE_COST();
-			if (abs(obj->GetLoc().x - xy.x) == 1 && abs(obj->GetLoc().y - xy.y) == 2)
-				return Config::get().Get_SAFE_COST();
-			if (abs(obj->GetLoc().x - xy.x) == 2 && abs(obj->GetLoc().y - xy.y) == 1)
-				return Config::get().Get_SAFE_COST();
+		auto& ss = this->mSearch;
+		std::size_t states = this->mGrid.GetSize().x * this->mGrid.GetSize().y * 4;
+		if (ss.g_cost.size() != states) {
+			ss.g_cost.assign(states, 0);
+			ss.parent.assign(states, -1);
+			ss.seen.assign(states, 0);
+			ss.closed.assign(states, 0);
+			ss.target.assign(states, 0);
+			ss.generation = 0;
+		}
+		ss.open.clear();
+		if (++ss.generation == 0) {
+			//wrapped around, stale stamps could match again
+			std::fill(ss.seen.begin(), ss.seen.end(), 0);
+			std::fill(ss.closed.begin(), ss.closed.end(), 0);
+			std::fill(ss.target.begin(), ss.target.end(), 0);
+			ss.generation = 1;
 		}
-		return 0;
+	}
+
+	//x-major so that (f_distance, index) breaks ties by x, y then direction
+	int MazeSolver::StateIndex(const ObjectState& s) const
+	{
+		return (s.m_location.x * this->mGrid.GetSize().y + s.m_location.y) * 4 +
+			(static_cast<int>(s.m_Fd) - FaceDirection::FD_North);
+	}
+
+	ObjectState MazeSolver::IndexState(int index) const
+	{
+		int fd = index % 4 + FaceDirection::FD_North;
+		int cell = index / 4;
+		Point loc{ cell / this->mGrid.GetSize().y, cell % this->mGrid.GetSize().y };
+		return ObjectState(loc, static_cast<FaceDirection>(fd));
+	}
+
+	void MazeSolver::SelectMotions()
+	{
+		auto& turn = this->turn_wrt_big_turns[this->mBigTurn];
+		this->mMotions = MakeMotionTable(turn.left_wheel, turn.right_wheel);
+	}
+
+	bool MazeSolver::CanMove(const Point& from, const Motion& m, int& cost)
+	{
+		Point NewLoc = { from.x + m.offset.x, from.y + m.offset.y };
+		if (!m.turn) {
+			if (!this->mGrid.Reachable(NewLoc))
+				return false;
+			cost = this->GetSafeCost(NewLoc);
+			return true;
+		}
+		if (!this->mGrid.Reachable(NewLoc, true) || !this->mGrid.Reachable(from, false, true))
+			return false;
+		cost = this->GetSafeCost(NewLoc) + 10;
+		return true;
+	}
+
+	int MazeSolver::GetSafeCost(const Point& xy)
+	{
+		return this->mGrid.GetSafeCost(xy);
 	}
 
 	void MazeSolver::GenerateCombination(const std::vector<std::vector<ObjectState>>& view_pos, 
-		std::size_t index, std::vector<int>& current, std::vector<std::vector<int>>& result, 
+		std::size_t index, std::pmr::vector<int>& current, std::pmr::vector<std::pmr::vector<int>>& result,
 		std::size_t& iteration_left)
 	{
 		if (index == view_pos.size()) {
@@ -525,23 +1413,173 @@ namespace MDP {
 		}
 	}
 
-	void MazeSolver::RecordPath(const ObjectState& start, const ObjectState& end,
-		const std::unordered_map<ObjectState, ObjectState>& parent, int distance)
+	void MazeSolver::RecordPath(const ObjectState& start, const ObjectState& end, int distance)
+	{
+		auto& ss = this->mSearch;
+		int start_index = this->StateIndex(start);
+		std::pmr::vector<int> chain(1, this->StateIndex(end), this->mArena.Resource());
+		while (chain.back() != start_index)
+			chain.push_back(ss.parent[chain.back()]);
+
+		std::pmr::vector<MotionRun> runs(this->mArena.Resource());
+		for (std::size_t i = chain.size() - 1; i > 0; i--)
+			this->AppendMotion(runs, this->IndexState(chain[i]), this->IndexState(chain[i - 1]));
+		//only the searched direction, the cost of a leg depends on which end it lands on
+		if (this->mPathCache)
+			this->mPathCache->Store(start, end, distance, runs);
+		this->mLegs.Store(start, end, distance, runs);
+	}
+
+	void MazeSolver::AppendMotion(std::pmr::vector<MotionRun>& runs, const ObjectState& from, const ObjectState& to) const
+	{
+		auto& row = this->mMotions[from.m_Fd - FaceDirection::FD_North];
+		unsigned char motion = 0;
+		while (row[motion].to != to.m_Fd ||
+			row[motion].offset.x != to.m_location.x - from.m_location.x ||
+			row[motion].offset.y != to.m_location.y - from.m_location.y)
+			motion++;
+		if (!runs.empty() && runs.back().motion == motion && runs.back().count < 255)
+			runs.back().count++;
+		else
+			runs.push_back({ motion, 1 });
+	}
+
+	SearchTree& MazeSolver::GetTree(const ObjectState& target)
+	{
+		auto it = this->mTrees.find(target);
+		if (it != this->mTrees.end())
+			return it->second;
+		auto& tree = this->mTrees[target];
+		std::size_t states = this->mGrid.GetSize().x * this->mGrid.GetSize().y * 4;
+		tree.g.assign(states, TSP::UNREACHABLE);
+		tree.rhs.assign(states, TSP::UNREACHABLE);
+		tree.target = this->StateIndex(target);
+		tree.rhs[tree.target] = 0;
+		tree.open.push_back({ 0, tree.target });
+		SOLVER_STAT(this->mStats.searches++);
+		this->ComputeTree(tree);
+		return tree;
+	}
+
+	//every state that has a motion into index, whether or not that motion is currently drivable
+	void MazeSolver::GetPredecessors(int index, std::vector<int>& preds) const
+	{
+		preds.clear();
+		auto s = this->IndexState(index);
+		auto size = this->mGrid.GetSize();
+		for (auto& motions : this->mMotions)
+		{
+			for (auto& m : motions)
+			{
+				if (m.to != s.m_Fd)
+					continue;
+				Point from{ s.m_location.x - m.offset.x, s.m_location.y - m.offset.y };
+				if (from.x < 0 || from.x >= size.x || from.y < 0 || from.y >= size.y)
+					continue;
+				preds.push_back(this->StateIndex(ObjectState(from, m.from)));
+			}
+		}
+	}
+
+	void MazeSolver::UpdateTreeVertex(SearchTree& tree, int index)
+	{
+		if (index != tree.target)
+		{
+			auto s = this->IndexState(index);
+			int best = TSP::UNREACHABLE;
+			this->ForEachNeighbor(s, [&](const Neighbor& n) {
+				int next = this->StateIndex(n);
+				if (tree.g[next] == TSP::UNREACHABLE)
+					return;
+				int move_cost = this->MoveCost(s, n);
+				best = std::min(best, move_cost + tree.g[next]);
+			});
+			tree.rhs[index] = best;
+		}
+		if (tree.g[index] != tree.rhs[index]) {
+			tree.open.push_back({ std::min(tree.g[index], tree.rhs[index]), index });
+			std::push_heap(tree.open.begin(), tree.open.end(), std::greater<std::pair<int, int>>());
+			SOLVER_STAT(this->mStats.heap_pushes++);
+		}
+	}
+
+	//no heuristic, the tree is kept consistent over the whole lattice
+	void MazeSolver::ComputeTree(SearchTree& tree)
 	{
-		this->cost_table[{start, end}] = distance;
-		this->cost_table[{end, start}] = distance;
+		std::vector<int> preds;
+		while (!tree.open.empty())
+		{
+			std::pop_heap(tree.open.begin(), tree.open.end(), std::greater<std::pair<int, int>>());
+			auto [key, u] = tree.open.back();
+			tree.open.pop_back();
+			if (tree.g[u] == tree.rhs[u] || key != std::min(tree.g[u], tree.rhs[u]))
+				continue;
+			SOLVER_STAT(this->mStats.expansions++);
+			if (tree.g[u] > tree.rhs[u])
+				tree.g[u] = tree.rhs[u];
+			else {
+				tree.g[u] = TSP::UNREACHABLE;
+				this->UpdateTreeVertex(tree, u);
+			}
+			this->GetPredecessors(u, preds);
+			for (int p : preds)
+				this->UpdateTreeVertex(tree, p);
+		}
+	}
 
-		std::vector<PathData> path;
-		PathData temp{ end };
-		while (parent.find(temp) != parent.end()) {
-			path.push_back(temp);
-			temp = PathData(parent.at(temp));
+	void MazeSolver::RepairTrees(const Point& loc)
+	{
+		if (this->mTrees.empty())
+			return;
+		//an obstacle changes clearance/safe cost within manhattan 4, which changes the
+		//motions that start on or land in those cells
+		auto size = this->mGrid.GetSize();
+		std::vector<int> affected, preds;
+		for (int y = loc.y - 4; y <= loc.y + 4; y++)
+		{
+			for (int x = loc.x - 4; x <= loc.x + 4; x++)
+			{
+				if (x < 0 || x >= size.x || y < 0 || y >= size.y ||
+					abs(x - loc.x) + abs(y - loc.y) > 4)
+					continue;
+				for (auto& d : MOVE_DIRECTION) {
+					int index = this->StateIndex(ObjectState({ x, y }, d.direction));
+					affected.push_back(index);
+					this->GetPredecessors(index, preds);
+					affected.insert(affected.end(), preds.begin(), preds.end());
+				}
+			}
+		}
+		for (auto& [target, tree] : this->mTrees)
+		{
+			for (int index : affected)
+				this->UpdateTreeVertex(tree, index);
+			this->ComputeTree(tree);
+		}
+	}
+
+	void MazeSolver::RecordTreePath(const ObjectState& start, const ObjectState& end, const SearchTree& tree)
+	{
+		int start_index = this->StateIndex(start);
+		int distance = tree.g[start_index];
+
+		//walk down the tree, taking the first motion that keeps the cost-to-go exact
+		std::pmr::vector<MotionRun> runs(this->mArena.Resource());
+		for (int cur = start_index; cur != tree.target;)
+		{
+			auto s = this->IndexState(cur);
+			int next = -1;
+			this->ForEachNeighbor(s, [&](const Neighbor& n) {
+				int index = this->StateIndex(n);
+				if (next >= 0 || tree.g[index] == TSP::UNREACHABLE)
+					return;
+				if (this->MoveCost(s, n) + tree.g[index] == tree.g[cur])
+					next = index;
+			});
+			this->AppendMotion(runs, s, this->IndexState(next));
+			cur = next;
 		}
-		path.push_back(temp);
 
-		auto reversed = path;
-		std::reverse(reversed.begin(), reversed.end());
-		this->path_table[{start, end}] = reversed;
-		this->path_table[{end, start}] = path;
+		this->mLegs.Store(start, end, distance, runs);
 	}
 }
\ No newline at end of file
@@ -1,75 +1,385 @@
 #pragma once
-#include <Windows.h>
 #include "FieldObjects.hpp"
+#include "TSP.hpp"
+#include "Config.hpp"
+#include "Utils.hpp"
 #include <unordered_map>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <span>
+#include <memory_resource>
 
 namespace MDP {
+	//clearance bits rasterized per cell, see Grid::Reachable
+	enum ClearanceLayer : unsigned char {
+		CL_Plain = 1 << 0,
+		CL_Turn = 1 << 1,
+		CL_PreTurn = 1 << 2,
+	};
+
 	class Grid {
 
 	public:
-		Grid(const POINT& size);
+		Grid(const Point& size);
 
-		void AddObstacle(const POINT& loc, FaceDirection dir);
+		void AddObstacle(const Point& loc, FaceDirection dir);
 		void AddObstacle(const SFieldObject& obj);
 		std::vector<std::vector<ObjectState>> GetViewObstaclePositions(bool retrying);
-		bool Reachable(const POINT& xy, bool turn = false, bool preTurn = false);
+		bool Reachable(const Point& xy, bool turn = false, bool preTurn = false);
+		int GetSafeCost(const Point& xy) const;
 		std::vector<SFieldObject> GetObjects() const;
+		Point GetSize() const;
+		//true when xy is a cell of the grid, border cells included
+		bool Contains(const Point& xy) const;
+		//false when the grid is bigger than MAX_GRID_SIZE and cells would share a PoseKey,
+		//the solver returns no path on such a grid
+		bool FitsPoseKeys() const;
+		std::size_t GetReachableCalls() const;
 	private:
-		POINT mSize;
+		Point mSize;
 		std::vector<SFieldObject> mObjects;
+		//one ClearanceLayer mask per cell, row major (y * mSize.x + x)
+		std::vector<unsigned char> mClearance;
+		//SAFE_COST penalty per cell for hugging an obstacle, same layout as mClearance
+		std::vector<int> mSafeCost;
+		std::size_t mReachableCalls = 0;
 
-		bool IsValidCoord(const POINT& xy);
+		bool IsValidCoord(const Point& xy);
+		void RebuildClearance();
+		void StampClearance(const Point& loc);
+		void StampSafeCost(const Point& loc);
 	};
 
 
-	struct PathData : ObjectState {
+	//one move the robot can make from a facing, ForEachNeighbor applies these in order
+	struct Motion {
+		FaceDirection from;
+		FaceDirection to;
+		Point offset;
+		bool turn;
+	};
 
-		PathData(const ObjectState& s) :
-			ObjectState(s)
+	//2 straight moves and 4 turns per facing, rows indexed by m_Fd - FD_North
+	constexpr int MOTIONS_PER_FACING = 6;
+	using MotionTable = std::array<std::array<Motion, MOTIONS_PER_FACING>, 4>;
+
+	//successors for a (bigger, smaller) wheel displacement, ordered by the E, W, N, S sweep
+	//the search has always expanded them in, so ties break the same way
+	constexpr MotionTable MakeMotionTable(long bigger, long smaller)
+	{
+		constexpr FaceDirection sweep[4]{ FD_East, FD_West, FD_North, FD_South };
+		constexpr Point unit[4]{ {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+		const long b = bigger, s = smaller;
+		MotionTable table{};
+		for (int f = 0; f < 4; f++)
 		{
+			FaceDirection from = static_cast<FaceDirection>(FD_North + f);
+			int n = 0;
+			for (int k = 0; k < 4; k++)
+			{
+				FaceDirection to = sweep[k];
+				if (to == from) {
+					table[f][n++] = { from, to, unit[k], false };
+					table[f][n++] = { from, to, { -unit[k].x, -unit[k].y }, false };
+					continue;
+				}
+				Point first{}, second{};
+				switch (from)
+				{
+				//north > east/west
+				case FD_North:
+					if (to == FD_East) { first = { b, s }; second = { -s, -b }; }
+					else if (to == FD_West) { first = { s, -b }; second = { -b, s }; }
+					else continue;
+					break;
+				//east > north/south
+				case FD_East:
+					if (to == FD_North) { first = { s, b }; second = { -b, -s }; }
+					else if (to == FD_South) { first = { s, -b }; second = { -b, s }; }
+					else continue;
+					break;
+				//south > east/west
+				case FD_South:
+					if (to == FD_East) { first = { b, -s }; second = { -s, b }; }
+					else if (to == FD_West) { first = { -b, -s }; second = { s, b }; }
+					else continue;
+					break;
+				//west > south/north
+				case FD_West:
+					if (to == FD_South) { first = { -s, -b }; second = { b, s }; }
+					else if (to == FD_North) { first = { -s, b }; second = { b, -s }; }
+					else continue;
+					break;
+				default:
+					continue;
+				}
+				table[f][n++] = { from, to, first, true };
+				table[f][n++] = { from, to, second, true };
+			}
 		}
+		return table;
+	}
+
+	//count moves in a row with the same MotionTable column, a leg is stored as these runs
+	//from its start pose instead of one state per cell
+	struct MotionRun {
+		unsigned char motion;
+		unsigned char count;
 	};
 
+	//calls visit with every state the runs lead through after s
+	template<typename Visit>
+	void WalkRuns(ObjectState s, const MotionRun* runs, std::size_t count, const MotionTable& motions, Visit&& visit)
+	{
+		for (std::size_t r = 0; r < count; r++)
+		{
+			for (unsigned char i = 0; i < runs[r].count; i++)
+			{
+				auto& m = motions[s.m_Fd - FD_North][runs[r].motion];
+				s = ObjectState({ s.m_location.x + m.offset.x, s.m_location.y + m.offset.y }, m.to);
+				visit(s);
+			}
+		}
+	}
+
 	struct Neighbor : ObjectState {
 		int cost;
 
-		Neighbor(const POINT& loc, FaceDirection d, int cost) :
+		Neighbor(const Point& loc, FaceDirection d, int cost) :
 			ObjectState(loc, d), cost(cost)
 		{
 		}
 	};
 
+	//Pose-pair legs that outlive a single MazeSolver, so an edited layout only
+	//re-searches the legs the edit could have changed. Not thread safe, share it
+	//between solvers that run one after another.
+	class PathCache {
+
+	public:
+		struct Entry {
+			int cost;
+			std::vector<MotionRun> runs;
+		};
+
+		const Entry* Find(const ObjectState& start, const ObjectState& end) const;
+		void Store(const ObjectState& start, const ObjectState& end, int cost, std::span<const MotionRun> runs);
+		void Sync(const std::vector<Point>& obstacles, const std::vector<int>& signature, double move_scale,
+			const MotionTable& motions);
+		void Clear();
+		std::size_t Size() const;
+
+	private:
+		std::unordered_map<FieldStartEnd, Entry> mEntries;
+		//obstacle cells and solver settings the entries were searched against
+		std::vector<Point> mObstacles;
+		std::vector<int> mSignature;
+	};
+
+	//Legs searched by one MazeSolver. Poses are interned to dense ids by their PoseKey, so
+	//the bound, TSP and assembly loops index flat id x id tables instead of hashing pose
+	//pairs. A leg's motion runs are stored once, the other direction walks them backwards.
+	class LegTable {
+
+	public:
+		int Intern(const ObjectState& s);
+		//-1 when the pose was never interned
+		int Find(const ObjectState& s) const;
+		//TSP::UNREACHABLE when no leg between the two was recorded
+		int Cost(int from, int to) const;
+		bool Has(const ObjectState& start, const ObjectState& end) const;
+		void Store(const ObjectState& start, const ObjectState& end, int cost, std::span<const MotionRun> runs);
+		//the leg's runs in the direction they were searched, a view into the shared storage
+		std::span<const MotionRun> Runs(int from, int to) const;
+		//states the leg moves through, its start excluded
+		std::size_t Steps(int from, int to) const;
+		//appends the states after from up to and including to, returns how many
+		std::size_t Expand(int from, int to, const MotionTable& motions, std::vector<ObjectState>& out) const;
+		void Clear();
+
+	private:
+		//where a leg's runs sit in mRuns, reversed when they were searched from the other end
+		struct LegRef {
+			uint32_t first = 0;
+			uint32_t count = 0;
+			bool reversed = false;
+		};
+		std::unordered_map<PoseKey, int> mIds;
+		//pose per id, direction and location only
+		std::vector<ObjectState> mPoses;
+		//row length of mCost/mLegs, grown by doubling as poses are interned
+		std::size_t mStride = 0;
+		std::vector<int> mCost;
+		std::vector<LegRef> mLegs;
+		std::vector<MotionRun> mRuns;
+
+		void Grow(std::size_t poses);
+	};
+
+	//dense A* workspace indexed by (x, y, direction), reused across searches
+	struct SearchSpace {
+		std::vector<int> g_cost;
+		std::vector<int> parent;
+		//generation stamps, a state is only valid/closed if it matches the current generation
+		std::vector<unsigned int> seen;
+		std::vector<unsigned int> closed;
+		std::vector<unsigned int> target;
+		//min-heap of (f_distance, state index)
+		std::vector<std::pair<int, int>> open;
+		unsigned int generation = 0;
+	};
+
+	//LPA* tree of costs-to-go towards one target pose over the whole (x, y, direction)
+	//lattice, repaired in place when obstacles are added so a moved robot is a lookup
+	struct SearchTree {
+		std::vector<int> g;
+		std::vector<int> rhs;
+		int target;
+		//min-heap of (key, state index), stale entries are skipped on pop
+		std::vector<std::pair<int, int>> open;
+	};
+
+	//states one search closed before it settled a leg
+	struct LegStats {
+		ObjectState start;
+		ObjectState end;
+		std::size_t expansions;
+	};
+
+	//counters from the last GetOptimalOrderDP call, collected when SolverStats is on
+	struct SolveStats {
+		//searches run, leg trees built included
+		std::size_t searches = 0;
+		std::size_t path_cache_hits = 0;
+		std::size_t expansions = 0;
+		std::size_t heap_pushes = 0;
+		std::size_t reachable_calls = 0;
+		//obstacles dropped up front because none of their view poses can be reached
+		std::size_t unreachable_obstacles = 0;
+		//visit subsets whose legs were costed
+		std::size_t subsets_tried = 0;
+		std::size_t combinations_enumerated = 0;
+		std::size_t combinations_evaluated = 0;
+		std::size_t combinations_pruned = 0;
+		std::size_t tsp_calls = 0;
+		//heap allocations the solve's scratch needed past the arena block
+		std::size_t scratch_overflows = 0;
+		std::vector<LegStats> legs;
+		//wall time per phase, in milliseconds
+		double view_pose_ms = 0;
+		double path_cost_ms = 0;
+		double combination_ms = 0;
+		double tsp_ms = 0;
+		double assembly_ms = 0;
+	};
+
+	//where a GetOptimalOrderDP call is, done/total count the legs searched from each source
+	//and then the combinations tried in the visit subset being solved
+	struct SolveProgress {
+		std::size_t subset;
+		std::size_t subsets;
+		const char* stage;
+		std::size_t done;
+		std::size_t total;
+	};
+
 	class MazeSolver {
 		
 	public:
-		MazeSolver(const POINT& grid_size, const POINT& robot, FaceDirection robot_dir, bool big_turn = false);
+		MazeSolver(const Point& grid_size, const Point& robot, FaceDirection robot_dir, bool big_turn = false);
 
-		MazeSolver& AddObstacle(const POINT& loc, FaceDirection dir);
+		MazeSolver& AddObstacle(const Point& loc, FaceDirection dir);
 		MazeSolver& AddObstacle(const SFieldObject& obj);
+		MazeSolver& UpdateRobot(const Point& loc, FaceDirection dir);
+		void EnableIncrementalSearch(bool enable);
 		std::vector<SFieldObject> GetObstacles() const;
 		std::vector<ObjectState> GetOptimalOrderDP(bool retrying);
+		using Deadline = std::chrono::steady_clock::time_point;
+		//called with the full path and its cost every time the anytime solve finds a better tour,
+		//or once with a shorter path when the deadline passes before any full tour is known
+		using ImproveCallback = std::function<void(const std::vector<ObjectState>& path, int cost)>;
+		std::vector<ObjectState> GetOptimalOrderDP(bool retrying, Deadline deadline,
+			const ImproveCallback& on_improve = nullptr);
+		const SolveStats& GetStats() const;
+		void SetPathCache(const std::shared_ptr<PathCache>& cache);
+		//may be called from the combination workers, so it has to be thread safe
+		using ProgressCallback = std::function<void(const SolveProgress& progress)>;
+		void SetProgressCallback(const ProgressCallback& callback);
+		//safe from any thread, a running GetOptimalOrderDP stops at its next check and
+		//returns an empty path. Cancelling is terminal: the flag is never cleared, so a
+		//cancel that lands before the solve starts is not lost, and every later solve on
+		//this instance returns empty too. Build a new MazeSolver for the next run.
+		void Cancel();
+		bool IsCancelled() const;
 
 	private:
 		bool mBigTurn;
 		Grid mGrid;
 		std::shared_ptr<FieldRobot> mRobot;
-		std::unordered_map<FieldStartEnd, std::vector<PathData>> path_table;
-		std::unordered_map<FieldStartEnd, int> cost_table;
+		LegTable mLegs;
 		struct WRT_BIG_TURNS {
 			int left_wheel;
 			int right_wheel;
 		}turn_wrt_big_turns[2];
+		MotionTable mMotions;
+		SearchSpace mSearch;
+		//one TSP scratch per worker thread
+		std::vector<TSP::Solver> mTSP;
+		//leg costs between the poses of the current subset, read by every combination
+		TSP::CostMatrix mCosts;
+		SolveStats mStats;
+		std::shared_ptr<PathCache> mPathCache;
+		bool mIncremental = false;
+		std::unordered_map<ObjectState, SearchTree> mTrees;
+		ProgressCallback mProgress;
+		std::atomic<bool> mCancelled{ false };
+		//scratch containers of a GetOptimalOrderDP call, kept warm between calls
+		Utils::Arena mArena;
 
-		void GeneratePathCost(const std::vector<ObjectState>& states);
+		bool GeneratePathCost(const std::vector<ObjectState>& states, Deadline deadline = Deadline::max(),
+			std::size_t subset = 0, std::size_t subsets = 1);
+		bool Expired(Deadline deadline) const;
+		void ReportProgress(std::size_t subset, std::size_t subsets, const char* stage, std::size_t done, std::size_t total);
+		void SyncPathCache();
+		bool LoadCachedPath(const ObjectState& start, const ObjectState& end);
 		void DoAStarSearch(const ObjectState& start, const ObjectState& end);
-		std::vector<Neighbor> GetNeighbors(const ObjectState& s);
+		void DoMultiTargetSearch(const ObjectState& start, std::span<const ObjectState> ends);
+		void BeginSearch();
+		int StateIndex(const ObjectState& s) const;
+		ObjectState IndexState(int index) const;
+		void SelectMotions();
+		bool CanMove(const Point& from, const Motion& m, int& cost);
+		template<typename Visit>
+		void ForEachNeighbor(const ObjectState& s, Visit&& visit);
+		int MoveCost(const ObjectState& from, const Neighbor& n) const;
 
-		int GetSafeCost(const POINT& xy);
+		int GetSafeCost(const Point& xy);
+		void DropUnreachablePoses(std::vector<std::vector<ObjectState>>& all_pos);
+		std::vector<int> InternPoses(const std::vector<ObjectState>& items);
+		void BuildCostMatrix(const std::vector<int>& ids);
+		int SolveGrouped(const std::vector<std::vector<ObjectState>>& view_pos, std::vector<int>& order);
+		void AssemblePath(const std::vector<ObjectState>& items, const std::vector<int>& ids,
+			const std::vector<int>& order, std::vector<ObjectState>& optimal_path);
+		int BuildCandidates(std::span<const int> c, const std::vector<std::vector<ObjectState>>& view_pos,
+			std::pmr::vector<int>& visited_candidates);
+		int CombinationBound(std::span<const int> visited_candidates);
+		int GreedyOrder(std::span<const int> visited_candidates, const std::vector<ObjectState>& items,
+			const std::vector<int>& ids, std::vector<int>& order);
+		int EvaluateCombination(std::span<const int> visited_candidates, int fixed_cost, TSP::Solver& tsp);
 		void GenerateCombination(const std::vector<std::vector<ObjectState>>& view_pos, 
-			std::size_t index, std::vector<int>& current, std::vector<std::vector<int>>& result,
+			std::size_t index, std::pmr::vector<int>& current, std::pmr::vector<std::pmr::vector<int>>& result,
 			std::size_t& iteration_left);
 
-		void RecordPath(const ObjectState& start, const ObjectState& end,
-			const std::unordered_map<ObjectState, ObjectState>& parent, int distance);
+		void RecordPath(const ObjectState& start, const ObjectState& end, int distance);
+		void AppendMotion(std::pmr::vector<MotionRun>& runs, const ObjectState& from, const ObjectState& to) const;
+
+		SearchTree& GetTree(const ObjectState& target);
+		void GetPredecessors(int index, std::vector<int>& preds) const;
+		void UpdateTreeVertex(SearchTree& tree, int index);
+		void ComputeTree(SearchTree& tree);
+		void RepairTrees(const Point& loc);
+		void RecordTreePath(const ObjectState& start, const ObjectState& end, const SearchTree& tree);
 	};
 }
\ No newline at end of file
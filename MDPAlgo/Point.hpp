@@ -0,0 +1,9 @@
+#pragma once
+
+namespace MDP {
+	//grid coordinate, laid out like the Win32 Point the solver used to take
+	struct Point {
+		long x;
+		long y;
+	};
+}
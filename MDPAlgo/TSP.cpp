@@ -1,92 +1,281 @@
 #include "TSP.hpp"
-#include <set>
-#include <map>
+#include "Config.hpp"
 #include <algorithm>
-#include <iterator>
+#include <cstdint>
 #include <iostream>
+#include <new>
+
+#if TSPSimd >= 1 && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#define TSP_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+//MSVC emits AVX2 intrinsics without a target switch
+#define TSP_TARGET_AVX2
+#else
+#define TSP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define TSP_AVX2 0
+#endif
 
 namespace TSP {
-	struct memo_struct {
-		int ni;
-		std::set<int> n;
+	namespace {
+		//lanes per AVX2 register, rows of the DP are padded to a multiple of it
+		const int LANES = 8;
+
+		using RelaxFn = void (*)(int* best, int* parent, const int* legs, int rest, int node, int width);
+
+		//best[p] = min(best[p], legs[p] + rest) for every p, legs[p] is the leg p -> node and
+		//rest the cheapest way on from node. An UNREACHABLE leg never wins, ties keep the
+		//earlier node.
+		void relax_scalar(int* best, int* parent, const int* legs, int rest, int node, int width)
+		{
+			for (int p = 0; p < width; p++)
+			{
+				if (legs[p] == UNREACHABLE)
+					continue;
+				int total = legs[p] + rest;
+				if (total < best[p]) {
+					best[p] = total;
+					parent[p] = node;
+				}
+			}
+		}
+
+#if TSP_AVX2
+		//same as relax_scalar, 8 nodes per step. legs + rest would wrap for an UNREACHABLE leg,
+		//so those lanes are pinned back to UNREACHABLE, which never compares below best.
+		TSP_TARGET_AVX2 void relax_avx2(int* best, int* parent, const int* legs, int rest, int node, int width)
+		{
+			const __m256i unreachable = _mm256_set1_epi32(UNREACHABLE);
+			const __m256i rest8 = _mm256_set1_epi32(rest);
+			const __m256i node8 = _mm256_set1_epi32(node);
+			for (int p = 0; p < width; p += LANES)
+			{
+				__m256i leg = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(legs + p));
+				__m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(best + p));
+				__m256i from = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(parent + p));
+				__m256i total = _mm256_blendv_epi8(_mm256_add_epi32(leg, rest8), unreachable,
+					_mm256_cmpeq_epi32(leg, unreachable));
+				__m256i better = _mm256_cmpgt_epi32(cur, total);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(best + p), _mm256_blendv_epi8(cur, total, better));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(parent + p), _mm256_blendv_epi8(from, node8, better));
+			}
+		}
 
-		bool operator<(const memo_struct& rhs) const
+		bool cpu_has_avx2()
 		{
-			if (this->ni < rhs.ni)
-				return true;
-			else if (this->ni > rhs.ni)
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+			__cpuid(info, 1);
+			//AVX and OSXSAVE, and the OS saving the ymm registers
+			if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
 				return false;
-			return this->n < rhs.n;
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			return __builtin_cpu_supports("avx2");
+#endif
 		}
+#endif
 
-		bool operator==(const memo_struct& rhs) const
+		RelaxFn select_relax()
 		{
-			return this->ni == rhs.ni &&
-				this->n == rhs.n;
+#if TSP_AVX2
+			if (cpu_has_avx2())
+				return relax_avx2;
+#endif
+			return relax_scalar;
 		}
-	};
 
-	std::map<memo_struct, int> memo;
+		int padded(int n)
+		{
+			return (n + LANES - 1) / LANES * LANES;
+		}
+	}
+
+	namespace {
+		const std::size_t CACHE_LINE = 64;
+		const std::size_t LINE_INTS = CACHE_LINE / sizeof(int);
+	}
 
-	std::set<int> difference(const std::set<int>& s1, const std::set<int>& s2) 
+	void CostMatrix::AlignedDelete::operator()(int* cells) const
 	{
-		std::set<int> result;
-		std::set_difference(s1.begin(), s1.end(), s2.begin(), s2.end(),
-			std::inserter(result, result.end()));
-		return result;
+		::operator delete[](cells, std::align_val_t{ CACHE_LINE });
 	}
 
-	int dist(const std::vector<std::vector<int>>& distance_matrix, int ni, const std::set<int>& N)
+	void CostMatrix::resize(int n)
 	{
-		if (N.empty())
-			return distance_matrix[ni][0];
-
-		struct temp_cost {
-			int nmin;
-			int cost;
-		};
-		std::vector<temp_cost> cost;
-		cost.resize(N.size());
-		int index = 0;
-		for (auto& nj : N) {
-			cost[index++] = { nj, distance_matrix[ni][nj] + dist(distance_matrix, nj, difference(N, { nj })) };
+		this->n = n;
+		this->stride = (static_cast<std::size_t>(n) + LINE_INTS - 1) / LINE_INTS * LINE_INTS;
+		std::size_t needed = static_cast<std::size_t>(n) * this->stride;
+		if (this->capacity < needed)
+		{
+			this->data.reset(static_cast<int*>(::operator new[](needed * sizeof(int), std::align_val_t{ CACHE_LINE })));
+			this->capacity = needed;
 		}
-		std::sort(cost.begin(), cost.end(), [](const temp_cost& l, const temp_cost& r) {
-			return l.cost < r.cost;
-		});
-		auto& lowest_cost = cost[0];
-		memo_struct t{ ni, N };
-#if LogTSP >= 1
-		std::cout << "[TSP-lowest, CostSize:" << cost.size() <<"]nmin:" << lowest_cost.nmin << "cost:" << lowest_cost.cost << std::endl;
-#endif
-		memo.insert(std::make_pair(t, lowest_cost.nmin));
+	}
 
-		return lowest_cost.cost;
+	int CostMatrix::size() const
+	{
+		return this->n;
 	}
 
-	TSP_Result solve(const std::vector<std::vector<int>>& distance_matrix)
+	int* CostMatrix::operator[](int row)
+	{
+		return this->data.get() + row * this->stride;
+	}
+
+	const int* CostMatrix::operator[](int row) const
 	{
-		memo.clear();
-		auto N_Size = distance_matrix.size();
-		std::set<int> N;
-		for (int i = 1; i < N_Size; i++) N.insert(i);
+		return this->data.get() + row * this->stride;
+	}
 
-		TSP_Result result;
-		result.best_distance = dist(distance_matrix, 0, N);
+	const TSP_Result& Solver::solve(const std::vector<std::vector<int>>& distance_matrix)
+	{
+		int n = static_cast<int>(distance_matrix.size());
+		this->width = padded(n);
+		this->legs.assign(static_cast<std::size_t>(n) * this->width, UNREACHABLE);
+		for (int p = 0; p < n; p++)
+		{
+			for (int q = 0; q < n; q++)
+				this->legs[q * this->width + p] = distance_matrix[p][q];
+		}
+		return this->solve_tour(n);
+	}
+
+	//the submatrix is gathered once, the DP below reads it many times per row
+	const TSP_Result& Solver::solve(const CostMatrix& distance_matrix, std::span<const int> nodes)
+	{
+		int n = static_cast<int>(nodes.size());
+		this->width = padded(n);
+		this->legs.assign(static_cast<std::size_t>(n) * this->width, UNREACHABLE);
+		for (int p = 0; p < n; p++)
+		{
+			const int* row = distance_matrix[nodes[p]];
+			for (int q = 0; q < n; q++)
+				this->legs[q * this->width + p] = row[nodes[q]];
+		}
+		return this->solve_tour(n);
+	}
+
+	//plain TSP is the grouped DP with every node 1..n-1 alone in its group
+	const TSP_Result& Solver::solve_tour(int n)
+	{
+		this->group.resize(n);
+		this->penalty.assign(n, 0);
+		for (int p = 0; p < n; p++)
+			this->group[p] = p - 1;
+		return this->solve_legs(n, this->group.data(), this->penalty.data(), std::max(n - 1, 0));
+	}
+
+	const TSP_Result& Solver::solve_grouped(const CostMatrix& distance_matrix,
+		std::span<const int> group, std::span<const int> penalty, int group_count)
+	{
+		int n = distance_matrix.size();
+		this->width = padded(n);
+		this->legs.assign(static_cast<std::size_t>(n) * this->width, UNREACHABLE);
+		for (int p = 0; p < n; p++)
+		{
+			const int* row = distance_matrix[p];
+			for (int q = 0; q < n; q++)
+				this->legs[q * this->width + p] = row[q];
+		}
+		return this->solve_legs(n, group.data(), penalty.data(), group_count);
+	}
+
+	//Held-Karp over bitmasks of the groups, node 0 is the fixed start and every other node p
+	//belongs to group[p]. dp[mask * width + p] is the cheapest way to leave p, visit one node
+	//of every group in mask and return to 0, parent holds the node visited right after p.
+	//A row is built by pushing every node q of mask into all of its rows' nodes at once:
+	//dp[mask][p] = min over q of legs[q][p] + penalty[q] + dp[mask without q's group][q],
+	//so the inner loop runs over contiguous p and vectorizes. Entries of nodes already in
+	//mask come out as garbage, they are never read.
+	const TSP_Result& Solver::solve_legs(int n, const int* group, const int* penalty, int group_count)
+	{
+		static const RelaxFn relax = select_relax();
+		RelaxFn kernel = this->simd ? relax : relax_scalar;
+		int width = this->width;
+		this->result.permutation.clear();
+		this->result.best_distance = UNREACHABLE;
+		if (n == 0)
+			return this->result;
+
+		uint32_t full = (1u << group_count) - 1;
+		//every entry read below is written first, so the scratch is never cleared
+		std::size_t table_size = (static_cast<std::size_t>(full) + 1) * width;
+		if (this->dp.size() < table_size) {
+			this->dp.resize(table_size);
+			this->parent.resize(table_size);
+		}
+		//legs[0 * width + p] is p -> 0, padding lanes included
+		std::copy(this->legs.begin(), this->legs.begin() + width, this->dp.begin());
+
+		for (uint32_t mask = 1; mask <= full; mask++)
+		{
+			if ((mask & 0xFF) == 0 && this->interrupted && this->interrupted())
+				return this->result;
+			int* best = this->dp.data() + mask * width;
+			int* from = this->parent.data() + mask * width;
+			std::fill(best, best + width, UNREACHABLE);
+			std::fill(from, from + width, -1);
+			for (int q = 1; q < n; q++)
+			{
+				if (!((mask >> group[q]) & 1))
+					continue;
+				int rest = this->dp[(mask & ~(1u << group[q])) * width + q];
+				if (rest == UNREACHABLE)
+					continue;
+				kernel(best, from, this->legs.data() + q * width, rest + penalty[q], q, width);
+			}
+		}
+
+		this->result.best_distance = this->dp[full * width];
 #if LogTSP >= 1
-		std::cout << "[TSP-memo]result.best_distance:" << result.best_distance << std::endl;
+		std::cout << "[TSP-memo]result.best_distance:" << this->result.best_distance << std::endl;
 #endif
+		this->result.permutation.push_back(0);
+		if (this->result.best_distance == UNREACHABLE)
+			return this->result;
 		int ni = 0;
-		result.permutation.push_back(0);
-
-		while (!N.empty()) {
-			ni = memo[{ ni, N }];
+		for (uint32_t mask = full; mask != 0;) {
+			ni = this->parent[mask * width + ni];
 #if LogTSP >= 1
 			std::cout << "[TSP-memo]ni:" << ni << std::endl;
 #endif
-			result.permutation.push_back(ni);
-			N = difference(N, { ni });
+			this->result.permutation.push_back(ni);
+			mask &= ~(1u << group[ni]);
 		}
-		return result;
+		return this->result;
+	}
+
+	const TSP_Result& Solver::last_result() const
+	{
+		return this->result;
+	}
+
+	void Solver::set_interrupt(const std::function<bool()>& interrupted)
+	{
+		this->interrupted = interrupted;
+	}
+
+	void Solver::set_simd(bool enabled)
+	{
+		this->simd = enabled;
+	}
+
+	TSP_Result solve(const std::vector<std::vector<int>>& distance_matrix)
+	{
+		Solver solver;
+		return solver.solve(distance_matrix);
+	}
+
+	bool simd_available()
+	{
+		return select_relax() != relax_scalar;
 	}
 }
\ No newline at end of file
@@ -1,11 +1,77 @@
 #pragma once
 #include <vector>
+#include <functional>
+#include <cstddef>
+#include <span>
+#include <memory>
 
 namespace TSP {
+	//marks a leg (or a whole tour) that cannot be driven
+	const int UNREACHABLE = 0x7FFFFFFF;
+
 	struct TSP_Result {
 		std::vector<int> permutation;
 		int best_distance;
 	};
 
+	//n x n distances in one contiguous block, every row starts on its own cache line
+	class CostMatrix {
+
+	public:
+		//keeps the storage when it is big enough, the cells are left unset
+		void resize(int n);
+		int size() const;
+		int* operator[](int row);
+		const int* operator[](int row) const;
+
+	private:
+		struct AlignedDelete {
+			void operator()(int* cells) const;
+		};
+		int n = 0;
+		//ints per row, a multiple of one cache line
+		std::size_t stride = 0;
+		std::size_t capacity = 0;
+		std::unique_ptr<int[], AlignedDelete> data;
+	};
+
+	//owns the DP scratch so repeated solves only allocate when a bigger instance shows up,
+	//one instance per thread
+	class Solver {
+
+	public:
+		const TSP_Result& solve(const std::vector<std::vector<int>>& distance_matrix);
+		//tour over the rows nodes[0..] of a bigger matrix, nodes[0] is the start and the
+		//permutation indexes into nodes
+		const TSP_Result& solve(const CostMatrix& distance_matrix, std::span<const int> nodes);
+		//generalized TSP: node 0 is the start, every other node p belongs to group[p] and
+		//costs penalty[p] to visit, the tour visits exactly one node out of every group
+		const TSP_Result& solve_grouped(const CostMatrix& distance_matrix,
+			std::span<const int> group, std::span<const int> penalty, int group_count);
+		const TSP_Result& last_result() const;
+		//polled every few hundred masks, returning true abandons the solve with an UNREACHABLE result
+		void set_interrupt(const std::function<bool()>& interrupted);
+		//false pins the DP to its scalar kernel, the results are the same either way
+		void set_simd(bool enabled);
+
+	private:
+		std::function<bool()> interrupted;
+		bool simd = true;
+		std::vector<int> dp;
+		std::vector<int> parent;
+		//the instance being solved by column, legs[q * width + p] is the leg p -> q and
+		//width is n padded to whole SIMD registers, the padding is UNREACHABLE
+		int width = 0;
+		std::vector<int> legs;
+		std::vector<int> group;
+		std::vector<int> penalty;
+		TSP_Result result;
+
+		const TSP_Result& solve_tour(int n);
+		const TSP_Result& solve_legs(int n, const int* group, const int* penalty, int group_count);
+	};
+
 	TSP_Result solve(const std::vector<std::vector<int>>& distance_matrix);
+	//whether Solver runs a SIMD kernel on this CPU unless set_simd(false) was called
+	bool simd_available();
 }
\ No newline at end of file
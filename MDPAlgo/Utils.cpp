@@ -11,5 +11,65 @@ std::ostream& operator<<(std::ostream& os, const std::vector<int>& vec)
 }
 
 namespace Utils {
-	
+	Arena::Arena(std::size_t initial_bytes) :
+		buffer(initial_bytes),
+		current(std::pmr::new_delete_resource())
+	{
+	}
+
+	Arena::Scope::Scope(Arena& arena) :
+		arena(arena),
+		memory(arena.Reserve()),
+		block(memory.data(), memory.size(), &arena.spill),
+		pool(&block)
+	{
+		arena.current = &this->pool;
+	}
+
+	Arena::Scope::~Scope()
+	{
+		this->arena.current = std::pmr::new_delete_resource();
+	}
+
+	std::pmr::memory_resource* Arena::Resource() const
+	{
+		return this->current;
+	}
+
+	std::size_t Arena::Overflows() const
+	{
+		return this->spill.allocations;
+	}
+
+	std::size_t Arena::Capacity() const
+	{
+		return this->buffer.size();
+	}
+
+	//grows the block by what the last scope spilled, only while no scope is using it
+	std::span<std::byte> Arena::Reserve()
+	{
+		if (this->spill.bytes > 0)
+			this->buffer.resize(this->buffer.size() + this->spill.bytes);
+		this->spill.allocations = 0;
+		this->spill.bytes = 0;
+		return this->buffer;
+	}
+
+	void* Arena::Spill::do_allocate(std::size_t bytes, std::size_t alignment)
+	{
+		this->allocations++;
+		this->bytes += bytes;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void Arena::Spill::do_deallocate(void* p, std::size_t bytes, std::size_t alignment)
+	{
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	bool Arena::Spill::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+	{
+		return this == &other;
+	}
 }
\ No newline at end of file
@@ -2,6 +2,12 @@
 #include <ostream>
 #include <vector>
 #include <sstream>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstddef>
+#include <memory_resource>
+#include <span>
 
 std::ostream& operator<<(std::ostream& os, const std::vector<int>& vec);
 
@@ -13,4 +19,97 @@ namespace Utils {
 		ss << value;
 		return ss.str();
 	}
+
+	//milliseconds between laps
+	class Stopwatch {
+
+	public:
+		Stopwatch() : last(std::chrono::steady_clock::now())
+		{
+		}
+
+		double Lap()
+		{
+			auto now = std::chrono::steady_clock::now();
+			double ms = std::chrono::duration<double, std::milli>(now - this->last).count();
+			this->last = now;
+			return ms;
+		}
+	private:
+		std::chrono::steady_clock::time_point last;
+	};
+
+	//Scratch memory for one solve. Containers built on Resource() while a Scope is open
+	//bump-allocate out of one block, with freed memory pooled for reuse, and all of it is
+	//dropped at once when the Scope closes. The block outlives the scope and grows to the
+	//biggest scope seen, so a warmed-up owner no longer reaches the heap for scratch.
+	//One scope at a time, and only the thread that opened it may allocate from it.
+	class Arena {
+
+	public:
+		class Scope {
+
+		public:
+			explicit Scope(Arena& arena);
+			~Scope();
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+		private:
+			Arena& arena;
+			std::span<std::byte> memory;
+			std::pmr::monotonic_buffer_resource block;
+			std::pmr::unsynchronized_pool_resource pool;
+		};
+
+		Arena(std::size_t initial_bytes = 64 * 1024);
+		//the open scope's pool, the plain heap while no scope is open
+		std::pmr::memory_resource* Resource() const;
+		//heap allocations the current or last scope needed past the block
+		std::size_t Overflows() const;
+		std::size_t Capacity() const;
+
+	private:
+		//what the block hands on to the heap once it is full, counted so the next scope
+		//starts with enough room
+		class Spill : public std::pmr::memory_resource {
+
+		public:
+			std::size_t allocations = 0;
+			std::size_t bytes = 0;
+
+		private:
+			void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+			void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+			bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+		};
+
+		std::vector<std::byte> buffer;
+		Spill spill;
+		std::pmr::memory_resource* current;
+
+		std::span<std::byte> Reserve();
+	};
+
+	//hands out [0, count) in chunks to worker threads, the calling thread being worker 0.
+	//fn(worker, index) is called exactly once per index; a worker that runs out of work
+	//grabs the next free chunk, so uneven items balance themselves out.
+	template <typename Fn>
+	void parallel_for(std::size_t count, std::size_t workers, std::size_t chunk, Fn&& fn)
+	{
+		std::atomic<std::size_t> next{ 0 };
+		auto run = [&](std::size_t worker) {
+			for (std::size_t begin = next.fetch_add(chunk); begin < count; begin = next.fetch_add(chunk)) {
+				std::size_t end = begin + chunk < count ? begin + chunk : count;
+				for (std::size_t i = begin; i < end; i++)
+					fn(worker, i);
+			}
+		};
+		std::vector<std::thread> threads;
+		for (std::size_t w = 1; w < workers; w++)
+			threads.emplace_back(run, w);
+		run(0);
+		for (auto& t : threads)
+			t.join();
+	}
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <QSettings>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <chrono>
 
 #include "../MDPAlgo/MazeSolver.hpp"
 #include "../MDPAlgo/Config.hpp"
@@ -18,6 +19,7 @@ MainForm::MainForm(QWidget *parent)
 {
 	ui.setupUi(this);
 	this->animationTimer = new QTimer(this);
+	this->path_cache = std::make_shared<MDP::PathCache>();
 
 	QString styleSheet =
 		"*[gridBtn=\"true\"] {"
@@ -99,6 +101,7 @@ MainForm::MainForm(QWidget *parent)
 	});
 
 	connect(this->ui.bCalculate, &QPushButton::clicked, this, &MainForm::OnCalculateClicked);
+	connect(this->ui.bCancel, &QPushButton::clicked, this, &MainForm::OnCancelClicked);
 	connect(this->ui.cBAnimatePath, &QCheckBox::stateChanged, this, &MainForm::OnAnimateChecked);
 	connect(this->animationTimer, &QTimer::timeout, this, &MainForm::OnAnimateTick);
 
@@ -125,7 +128,14 @@ MainForm::MainForm(QWidget *parent)
 }
 
 MainForm::~MainForm()
-{}
+{
+	//the worker holds this form's path cache and posts progress to it, stop it first
+	if (this->solveThread) {
+		this->solveJob->solver->Cancel();
+		this->solveThread->wait();
+		delete this->solveThread;
+	}
+}
 
 bool MainForm::eventFilter(QObject* obj, QEvent* event)
 {
@@ -190,7 +200,7 @@ void MainForm::RedrawGridButtons()
 	}
 }
 
-POINT MainForm::GetButtonLocation(QPushButton* btn)
+MDP::Point MainForm::GetButtonLocation(QPushButton* btn)
 {
 	for (int x = 0; x < this->GridSize.x(); x++)
 	{
@@ -204,7 +214,7 @@ POINT MainForm::GetButtonLocation(QPushButton* btn)
 	return { -1,-1 };
 }
 
-MDP::SFieldObject MainForm::GetObjectByLocation(const POINT& loc)
+MDP::SFieldObject MainForm::GetObjectByLocation(const MDP::Point& loc)
 {
 	for (auto& obj : this->field_objects) {
 		if (obj->IsInRect(loc)) return obj;
@@ -258,14 +268,93 @@ void MainForm::OnResetObstaclesClicked()
 
 void MainForm::OnCalculateClicked()
 {
+	if (this->solveThread) return;
 	auto robot = this->GetRobot();
 	if (!robot) return;
-	MDP::MazeSolver solver({ this->GridSize.x(), this->GridSize.y() }, robot->GetLoc(), robot->GetDirection());
+	auto job = std::make_shared<SolveJob>();
+	job->solver = std::make_shared<MDP::MazeSolver>(MDP::Point{ this->GridSize.x(), this->GridSize.y() },
+		robot->GetLoc(), robot->GetDirection());
+	job->solver->SetPathCache(this->path_cache);
 	for (auto& o : this->field_objects) {
-		if (!std::dynamic_pointer_cast<MDP::FieldRobot>(o))
-			solver.AddObstacle(o);
+		if (std::dynamic_pointer_cast<MDP::FieldRobot>(o))
+			continue;
+		//copies, so the grid can be edited while the worker reads the layout
+		auto obj = std::make_shared<MDP::FieldBlock>(o->GetLoc(), o->GetDirection());
+		obj->UpdateSnapshotID(o->GetSnapshotID());
+		job->solver->AddObstacle(obj);
+	}
+
+	//reports come from the combination workers too, post at most one every 50ms
+	auto last_report = std::make_shared<std::atomic<long long>>(0);
+	job->solver->SetProgressCallback([this, last_report](const MDP::SolveProgress& p) {
+		long long now = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+		long long last = last_report->load(std::memory_order_relaxed);
+		if (now - last < 50 || !last_report->compare_exchange_strong(last, now, std::memory_order_relaxed))
+			return;
+		QString stage = QString("Subset %1, %2").arg(p.subset + 1).arg(QString::fromLatin1(p.stage));
+		int done = static_cast<int>(p.done), total = static_cast<int>(p.total);
+		QMetaObject::invokeMethod(this, [this, stage, done, total]() {
+			this->OnSolveProgress(stage, done, total);
+		}, Qt::QueuedConnection);
+	});
+
+	this->solveJob = job;
+	this->solveThread = QThread::create([job]() {
+		job->result = job->solver->GetOptimalOrderDP(false);
+		job->commands = MDP::command_generator(job->result, job->solver->GetObstacles());
+	});
+	connect(this->solveThread, &QThread::finished, this, &MainForm::OnSolveFinished);
+	this->SetSolving(true);
+	this->solveThread->start();
+}
+
+void MainForm::OnCancelClicked()
+{
+	if (!this->solveThread) return;
+	this->solveJob->solver->Cancel();
+	this->ui.bCancel->setEnabled(false);
+	this->ui.statusBar->showMessage("Cancelling...");
+}
+
+void MainForm::OnSolveProgress(const QString& stage, int done, int total)
+{
+	//a report queued before the worker finished can arrive after OnSolveFinished
+	if (!this->solveThread) return;
+	this->ui.SolveProgress->setRange(0, std::max(total, 1));
+	this->ui.SolveProgress->setValue(done);
+	this->ui.SolveProgress->setFormat(stage + ": %v/%m");
+}
+
+void MainForm::SetSolving(bool solving)
+{
+	//the worker reads Config, keep it fixed until the solve is over
+	this->ui.bCalculate->setEnabled(!solving);
+	this->ui.bCancel->setEnabled(solving);
+	this->ui.groupBox->setEnabled(!solving);
+	this->ui.cBLimit90FWBW->setEnabled(!solving);
+	this->ui.cBOutsideCommands->setEnabled(!solving);
+	this->ui.SolveProgress->setRange(0, 1);
+	this->ui.SolveProgress->setValue(0);
+	this->ui.SolveProgress->setFormat(solving ? "Solving..." : "%p%");
+	if (solving)
+		this->ui.statusBar->showMessage("Solving...");
+}
+
+void MainForm::OnSolveFinished()
+{
+	auto job = this->solveJob;
+	this->solveThread->deleteLater();
+	this->solveThread = nullptr;
+	this->solveJob = nullptr;
+	this->SetSolving(false);
+	if (job->solver->IsCancelled()) {
+		this->ui.statusBar->showMessage("Calculation cancelled");
+		return;
 	}
-	this->result = solver.GetOptimalOrderDP(false);
+	this->ui.SolveProgress->setValue(1);
+	this->ui.statusBar->showMessage(job->result.empty() ? "No path found" : "Calculation done");
+	this->result = job->result;
 
 	this->ui.PathTable->setRowCount(0);
 	for (auto& entry : this->result)
@@ -284,9 +373,8 @@ void MainForm::OnCalculateClicked()
 		this->ui.PathTable->setItem(row, 3, new QTableWidgetItem(
 			QString::number(entry.snapshot_id)));
 	}
-	auto commands = MDP::command_generator(this->result, solver.GetObstacles());
 	this->ui.CommandList->setRowCount(0);
-	for (auto& c : commands)
+	for (auto& c : job->commands)
 	{
 		int row = this->ui.CommandList->rowCount();
 		this->ui.CommandList->insertRow(row);
@@ -300,11 +388,45 @@ void MainForm::OnCalculateClicked()
 		this->ui.CommandList->setItem(row, 2, new QTableWidgetItem(
 			QString::fromStdString(c.ToString())));
 	}
+	this->ShowStats(job->solver->GetStats());
 
 	this->CurResultTick = 0;
 	this->RedrawGridButtons();
 }
 
+void MainForm::ShowStats(const MDP::SolveStats& stats)
+{
+	this->ui.StatsTable->setRowCount(0);
+#if SolverStats >= 1
+	auto AddRow = [this](const QString& name, const QString& value) {
+		int row = this->ui.StatsTable->rowCount();
+		this->ui.StatsTable->insertRow(row);
+		this->ui.StatsTable->setItem(row, 0, new QTableWidgetItem(name));
+		this->ui.StatsTable->setItem(row, 1, new QTableWidgetItem(value));
+	};
+	auto Count = [](std::size_t value) { return QString("%L1").arg(value); };
+	auto Millis = [](double value) { return QString("%L1 ms").arg(value, 0, 'f', 2); };
+
+	AddRow("Searches", Count(stats.searches));
+	AddRow("Path cache hits", Count(stats.path_cache_hits));
+	AddRow("Nodes expanded", Count(stats.expansions));
+	AddRow("Heap pushes", Count(stats.heap_pushes));
+	AddRow("Reachable calls", Count(stats.reachable_calls));
+	AddRow("Unreachable obstacles", Count(stats.unreachable_obstacles));
+	AddRow("Subsets tried", Count(stats.subsets_tried));
+	AddRow("Combinations", Count(stats.combinations_enumerated));
+	AddRow("Combinations evaluated", Count(stats.combinations_evaluated));
+	AddRow("Combinations pruned", Count(stats.combinations_pruned));
+	AddRow("TSP calls", Count(stats.tsp_calls));
+	AddRow("Scratch heap allocations", Count(stats.scratch_overflows));
+	AddRow("View poses", Millis(stats.view_pose_ms));
+	AddRow("Path cost", Millis(stats.path_cost_ms));
+	AddRow("Combination", Millis(stats.combination_ms));
+	AddRow("TSP", Millis(stats.tsp_ms));
+	AddRow("Assembly", Millis(stats.assembly_ms));
+#endif
+}
+
 void MainForm::OnAnimateChecked()
 {
 	if (this->ui.cBAnimatePath->isChecked())
@@ -427,7 +549,7 @@ void MainForm::OnLoadObstacles()
 	int count = 0;
 	stream >> count;
 	for (int i = 0; i < count; i++) {
-		auto obj = std::make_shared<MDP::FieldBlock>(POINT{ 1,1 });
+		auto obj = std::make_shared<MDP::FieldBlock>(MDP::Point{ 1,1 });
 		
 		int snapshot_id = -1;
 		int x = 0, y = 0;
@@ -439,7 +561,7 @@ void MainForm::OnLoadObstacles()
 		stream >> fd;
 
 		obj->UpdateSnapshotID(snapshot_id);
-		obj->Update(POINT{ x,y }, fd);
+		obj->Update(MDP::Point{ x,y }, fd);
 		this->field_objects.push_back(obj);
 	}
 	this->RedrawGridButtons();
@@ -3,8 +3,16 @@
 #include <QtWidgets/QMainWindow>
 #include "ui_MainForm.h"
 #include "../MDPAlgo/FieldObjects.hpp"
+#include "../MDPAlgo/Commands.hpp"
 #include <vector>
 #include <QTimer>
+#include <QThread>
+
+namespace MDP {
+	class PathCache;
+	class MazeSolver;
+	struct SolveStats;
+}
 
 class MainForm : public QMainWindow
 {
@@ -23,18 +31,33 @@ private:
 	std::vector<MDP::SFieldObject> field_objects;
 	int CurResultTick;
 	std::vector<MDP::ObjectState> result;
+	//legs searched by previous solves, reused across layout edits
+	std::shared_ptr<MDP::PathCache> path_cache;
+	//solve running on solveThread, filled in by the worker and read back in OnSolveFinished
+	struct SolveJob {
+		std::shared_ptr<MDP::MazeSolver> solver;
+		std::vector<MDP::ObjectState> result;
+		std::vector<MDP::Command> commands;
+	};
+	std::shared_ptr<SolveJob> solveJob;
+	QThread* solveThread = nullptr;
 
 	bool eventFilter(QObject* obj, QEvent* event) override;
 
 	void RedrawGridButtons();
 
-	POINT GetButtonLocation(QPushButton* btn);
-	MDP::SFieldObject GetObjectByLocation(const POINT& loc);
+	MDP::Point GetButtonLocation(QPushButton* btn);
+	MDP::SFieldObject GetObjectByLocation(const MDP::Point& loc);
 	MDP::SFieldObject GetRobot();
 
 	void OnGridButtonClicked();
 	void OnResetObstaclesClicked();
 	void OnCalculateClicked();
+	void OnCancelClicked();
+	void OnSolveProgress(const QString& stage, int done, int total);
+	void OnSolveFinished();
+	void SetSolving(bool solving);
+	void ShowStats(const MDP::SolveStats& stats);
 	void OnAnimateChecked();
 	void OnAnimateTick();
 
@@ -0,0 +1,50 @@
+#pragma once
+#include "FieldObjects.hpp"
+#include <cstddef>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+//Random layouts for mdp-bench and the tests. Draws are rng() % n rather than
+//std::uniform_int_distribution, so a seed gives the same layouts with every standard library.
+namespace Seeded {
+	struct Layout {
+		std::vector<std::pair<MDP::Point, MDP::FaceDirection>> obstacles;
+	};
+
+	inline int Draw(std::mt19937& rng, int n)
+	{
+		return static_cast<int>(rng() % n);
+	}
+
+	inline MDP::FaceDirection DrawDirection(std::mt19937& rng)
+	{
+		return static_cast<MDP::FaceDirection>(MDP::FD_North + rng() % 4);
+	}
+
+	//count obstacles on distinct cells, clear of the robot start zone in the lower left corner
+	inline Layout MakeLayout(std::mt19937& rng, std::size_t count, const MDP::Point& grid)
+	{
+		Layout layout;
+		std::set<std::pair<long, long>> used;
+		while (layout.obstacles.size() < count) {
+			MDP::Point p{ long(rng() % grid.x), long(rng() % grid.y) };
+			//a quarter of the obstacles hug a wall, where view poses fall off the grid
+			if (rng() % 4 == 0) {
+				switch (rng() % 4) {
+				case 0: p.x = 0; break;
+				case 1: p.x = grid.x - 1; break;
+				case 2: p.y = 0; break;
+				case 3: p.y = grid.y - 1; break;
+				}
+			}
+			if (p.x < 5 && p.y < 5)
+				continue;
+			if (!used.insert({ p.x, p.y }).second)
+				continue;
+			layout.obstacles.push_back({ p, DrawDirection(rng) });
+		}
+		return layout;
+	}
+}
@@ -0,0 +1,290 @@
+#include "MazeSolver.hpp"
+#include "Config.hpp"
+#include "Utils.hpp"
+#include "SeededLayout.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//phases in the order GetOptimalOrderDP runs them, plus the whole solve
+const char* PHASES[] = { "view_pose", "path_cost", "combination", "tsp", "assembly", "total" };
+const int PHASE_COUNT = sizeof(PHASES) / sizeof(PHASES[0]);
+const char* PERCENTILES[] = { "p50", "p99" };
+
+struct Sample {
+	std::size_t obstacles;
+	double phase_ms[PHASE_COUNT];
+	//heap allocations made during GetOptimalOrderDP, worker threads included
+	std::size_t allocations;
+	bool solved;
+};
+
+//every heap allocation in the process, a solve's share is the difference around it
+static std::atomic<std::size_t> g_allocations{ 0 };
+
+void* operator new(std::size_t size)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+//the cache-aligned buffers (TSP::CostMatrix) come through the aligned forms
+void* operator new(std::size_t size, std::align_val_t align)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	std::size_t alignment = static_cast<std::size_t>(align);
+	size = (size + alignment - 1) / alignment * alignment;
+#if defined(_MSC_VER)
+	if (void* p = _aligned_malloc(size ? size : alignment, alignment))
+#else
+	if (void* p = std::aligned_alloc(alignment, size ? size : alignment))
+#endif
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+#if defined(_MSC_VER)
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t align) noexcept
+{
+	operator delete(p, align);
+}
+
+static double Percentile(std::vector<double> values, double p)
+{
+	if (values.empty())
+		return 0;
+	std::sort(values.begin(), values.end());
+	//nearest rank
+	std::size_t rank = static_cast<std::size_t>(p * values.size() + 0.999999);
+	return values[std::min(values.size(), std::max<std::size_t>(rank, 1)) - 1];
+}
+
+static void WriteSummary(std::ostream& os, const std::vector<double>& values)
+{
+	double sum = 0;
+	for (double v : values)
+		sum += v;
+	os << "{\"mean\": " << (values.empty() ? 0 : sum / values.size())
+		<< ", \"p50\": " << Percentile(values, 0.50)
+		<< ", \"p90\": " << Percentile(values, 0.90)
+		<< ", \"p99\": " << Percentile(values, 0.99)
+		<< ", \"max\": " << (values.empty() ? 0 : *std::max_element(values.begin(), values.end())) << "}";
+}
+
+static std::string ToJson(unsigned seed, const std::string& mode, const std::vector<Sample>& samples, std::size_t max_obstacles)
+{
+	std::ostringstream os;
+	os << std::fixed << std::setprecision(4);
+	std::size_t unsolved = 0;
+	for (auto& s : samples)
+		unsolved += !s.solved;
+	os << "{\n  \"seed\": " << seed << ",\n  \"mode\": \"" << mode << "\",\n  \"layouts\": " << samples.size()
+		<< ",\n  \"unsolved\": " << unsolved << ",\n  \"phases\": {\n";
+	for (int p = 0; p < PHASE_COUNT; p++) {
+		std::vector<double> values;
+		for (auto& s : samples)
+			values.push_back(s.phase_ms[p]);
+		os << "    \"" << PHASES[p] << "\": ";
+		WriteSummary(os, values);
+		os << (p + 1 < PHASE_COUNT ? ",\n" : "\n");
+	}
+	std::vector<double> allocations;
+	for (auto& s : samples)
+		allocations.push_back(static_cast<double>(s.allocations));
+	os << "  },\n  \"allocations\": {\n    \"solve\": ";
+	WriteSummary(os, allocations);
+	os << "\n  },\n  \"obstacles\": {\n";
+	bool first = true;
+	for (std::size_t k = 1; k <= max_obstacles; k++) {
+		std::vector<double> values;
+		for (auto& s : samples)
+			if (s.obstacles == k)
+				values.push_back(s.phase_ms[PHASE_COUNT - 1]);
+		if (values.empty())
+			continue;
+		os << (first ? "" : ",\n") << "    \"" << k << "\": ";
+		WriteSummary(os, values);
+		first = false;
+	}
+	os << "\n  }\n}\n";
+	return os.str();
+}
+
+//reads "section": { ... "name": { ... "key": value out of a file this program wrote
+static bool FindValue(const std::string& json, const std::string& section, const std::string& name,
+	const std::string& key, double& value)
+{
+	auto pos = json.find("\"" + section + "\"");
+	if (pos == std::string::npos)
+		return false;
+	pos = json.find("\"" + name + "\"", pos);
+	if (pos == std::string::npos)
+		return false;
+	auto end = json.find('}', pos);
+	pos = json.find("\"" + key + "\":", pos);
+	if (pos == std::string::npos || pos > end)
+		return false;
+	value = std::strtod(json.c_str() + pos + key.size() + 3, nullptr);
+	return true;
+}
+
+//"mode": "..." out of a report, reports from before the option ran the grouped solve
+static std::string FindMode(const std::string& json)
+{
+	auto pos = json.find("\"mode\": \"");
+	if (pos == std::string::npos)
+		return "grouped";
+	pos += 9;
+	return json.substr(pos, json.find('"', pos) - pos);
+}
+
+//a phase regresses when it is slower than the baseline by more than tolerance (relative)
+//and slack_ms (absolute), the latter keeping sub-millisecond phases from flapping
+static int CompareBaseline(const std::string& current, const std::string& baseline, double tolerance, double slack_ms)
+{
+	int regressions = 0;
+	std::cerr << std::fixed << std::setprecision(3);
+	for (auto* phase : PHASES) {
+		for (auto* key : PERCENTILES) {
+			double now = 0, base = 0;
+			if (!FindValue(baseline, "phases", phase, key, base) || !FindValue(current, "phases", phase, key, now)) {
+				std::cerr << phase << " " << key << ": missing from baseline\n";
+				continue;
+			}
+			bool regressed = now > base * (1 + tolerance) && now - base > slack_ms;
+			regressions += regressed;
+			std::cerr << std::left << std::setw(12) << phase << " " << key << ": " << base << " -> " << now << " ms"
+				<< (base > 0 ? " (" + std::to_string(int((now / base - 1) * 100)) + "%)" : "")
+				<< (regressed ? "  REGRESSED" : "") << "\n";
+		}
+	}
+	//reported only, allocation counts move with the standard library
+	for (auto* key : PERCENTILES) {
+		double now = 0, base = 0;
+		if (FindValue(baseline, "allocations", "solve", key, base) && FindValue(current, "allocations", "solve", key, now))
+			std::cerr << std::left << std::setw(12) << "allocations" << " " << key << ": " << base << " -> " << now << "\n";
+	}
+	return regressions;
+}
+
+static void Usage()
+{
+	std::cerr <<
+		"usage: mdp-bench [options]\n"
+		"  -s <seed>        layout seed, default 1\n"
+		"  -n <layouts>     layouts per obstacle count, default 8\n"
+		"  -k <max>         obstacle counts 1..max, default 12\n"
+		"  -t <threads>     solver THREADS setting, default 0 (all hardware threads)\n"
+		"  -m <mode>        grouped (one generalized TSP, default) or combinations\n"
+		"                   (a TSP per view pose combination, GeneralizedTSP off)\n"
+		"  -o <file>        write the JSON report to file instead of stdout\n"
+		"  -b <file>        compare p50/p99 per phase against a report stored with the same -s/-n/-k/-m\n"
+		"  --tolerance <r>  allowed relative slowdown, default 0.25\n"
+		"  --slack <ms>     allowed absolute slowdown, default 1\n"
+		"Exits with 1 when a phase regressed against the baseline.\n";
+}
+
+int main(int argc, char** argv)
+{
+	unsigned seed = 1;
+	std::size_t per_count = 8, max_obstacles = 12;
+	std::string out_file, baseline_file, mode = "grouped";
+	double tolerance = 0.25, slack_ms = 1;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc || arg == "-h" || arg == "--help") {
+			Usage();
+			return arg == "-h" || arg == "--help" ? 0 : 2;
+		}
+		const char* value = argv[++i];
+		if (arg == "-s") seed = std::strtoul(value, nullptr, 10);
+		else if (arg == "-n") per_count = std::strtoul(value, nullptr, 10);
+		else if (arg == "-k") max_obstacles = std::strtoul(value, nullptr, 10);
+		else if (arg == "-t") MDP::Config::get().Set_THREADS(std::atoi(value));
+		else if (arg == "-m") mode = value;
+		else if (arg == "-o") out_file = value;
+		else if (arg == "-b") baseline_file = value;
+		else if (arg == "--tolerance") tolerance = std::strtod(value, nullptr);
+		else if (arg == "--slack") slack_ms = std::strtod(value, nullptr);
+		else {
+			Usage();
+			return 2;
+		}
+	}
+
+	if (mode != "grouped" && mode != "combinations") {
+		Usage();
+		return 2;
+	}
+	MDP::Config::get().Set_GeneralizedTSP(mode == "grouped");
+
+	const MDP::Point grid{ 20, 20 };
+	std::mt19937 rng(seed);
+	std::vector<Sample> samples;
+	for (std::size_t k = 1; k <= max_obstacles; k++) {
+		for (std::size_t n = 0; n < per_count; n++) {
+			auto layout = Seeded::MakeLayout(rng, k, grid);
+			Utils::Stopwatch watch;
+			MDP::MazeSolver solver(grid, { 1, 1 }, MDP::FD_North);
+			int id = 0;
+			for (auto& [loc, fd] : layout.obstacles)
+				solver.AddObstacle(std::make_shared<MDP::FieldBlock>(loc, fd, id++));
+			std::size_t allocations = g_allocations.load(std::memory_order_relaxed);
+			auto result = solver.GetOptimalOrderDP(false);
+			double total = watch.Lap();
+			allocations = g_allocations.load(std::memory_order_relaxed) - allocations;
+			auto& stats = solver.GetStats();
+			samples.push_back({ k, { stats.view_pose_ms, stats.path_cost_ms, stats.combination_ms,
+				stats.tsp_ms, stats.assembly_ms, total }, allocations, !result.empty() });
+		}
+	}
+
+	auto json = ToJson(seed, mode, samples, max_obstacles);
+	if (out_file.empty())
+		std::cout << json;
+	else
+		std::ofstream(out_file) << json;
+
+	if (baseline_file.empty())
+		return 0;
+	std::ifstream in(baseline_file);
+	if (!in) {
+		std::cerr << "cannot read baseline " << baseline_file << "\n";
+		return 2;
+	}
+	std::string baseline((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	if (FindMode(baseline) != mode) {
+		std::cerr << "baseline " << baseline_file << " was stored with -m " << FindMode(baseline) << "\n";
+		return 2;
+	}
+	return CompareBaseline(json, baseline, tolerance, slack_ms) ? 1 : 0;
+}
@@ -0,0 +1,232 @@
+#include "MazeSolver.hpp"
+#include "Commands.hpp"
+#include "Config.hpp"
+#include "Utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+//one .mdp file and what came out of solving it
+struct Scenario {
+	fs::path input;
+	fs::path output;
+	bool ok = false;
+	std::string error;
+	std::size_t poses = 0;
+	std::size_t commands = 0;
+	double ms = 0;
+};
+
+//.mdp files are written by MainForm through QDataStream: big endian qint32 count, then
+//snapshot id, x, y and facing per obstacle. The robot is not stored.
+static bool ReadInt(std::istream& in, int32_t& value)
+{
+	unsigned char b[4];
+	if (!in.read(reinterpret_cast<char*>(b), 4))
+		return false;
+	value = static_cast<int32_t>((uint32_t(b[0]) << 24) | (uint32_t(b[1]) << 16) | (uint32_t(b[2]) << 8) | uint32_t(b[3]));
+	return true;
+}
+
+static bool LoadScenario(const fs::path& path, std::vector<MDP::SFieldObject>& obstacles, std::string& error)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in) {
+		error = "cannot open file";
+		return false;
+	}
+	int32_t count = 0;
+	if (!ReadInt(in, count) || count < 0) {
+		error = "bad obstacle count";
+		return false;
+	}
+	for (int32_t i = 0; i < count; i++) {
+		int32_t snapshot_id, x, y, fd;
+		if (!ReadInt(in, snapshot_id) || !ReadInt(in, x) || !ReadInt(in, y) || !ReadInt(in, fd)) {
+			error = "truncated obstacle " + std::to_string(i);
+			return false;
+		}
+		if (fd < MDP::FD_None || fd > MDP::FD_West) {
+			error = "bad facing on obstacle " + std::to_string(i);
+			return false;
+		}
+		auto obj = std::make_shared<MDP::FieldBlock>(MDP::Point{ x, y }, static_cast<MDP::FaceDirection>(fd));
+		obj->UpdateSnapshotID(snapshot_id);
+		obstacles.push_back(obj);
+	}
+	return true;
+}
+
+static void Solve(Scenario& s, const MDP::Point& grid, const MDP::Point& robot, MDP::FaceDirection robot_dir)
+{
+	std::vector<MDP::SFieldObject> obstacles;
+	if (!LoadScenario(s.input, obstacles, s.error))
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+	MDP::MazeSolver solver(grid, robot, robot_dir);
+	for (auto& o : obstacles)
+		solver.AddObstacle(o);
+	auto result = solver.GetOptimalOrderDP(false);
+	auto commands = MDP::command_generator(result, solver.GetObstacles());
+	s.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	if (result.empty()) {
+		s.error = "no path";
+		return;
+	}
+
+	//line 1: x,y,facing,snapshot per pose, line 2: the command string sent to the robot
+	std::ostringstream ss;
+	for (auto& state : result)
+		ss << state.m_location.x << "," << state.m_location.y << "," << state.m_Fd << "," << state.snapshot_id << ";";
+	ss << "\n";
+	for (std::size_t i = 0; i < commands.size(); i++)
+		ss << (i ? " " : "") << commands[i].ToString();
+	ss << "\n";
+
+	std::ofstream out(s.output);
+	if (!(out << ss.str())) {
+		s.error = "cannot write " + s.output.string();
+		return;
+	}
+	s.poses = result.size();
+	s.commands = commands.size();
+	s.ok = true;
+}
+
+static bool ParsePair(const char* text, char separator, long& a, long& b)
+{
+	char* end = nullptr;
+	a = std::strtol(text, &end, 10);
+	if (*end != separator)
+		return false;
+	b = std::strtol(end + 1, &end, 10);
+	return *end == '\0';
+}
+
+static_assert(MDP::MAX_GRID_SIZE == 16384, "the -g line of Usage quotes the limit");
+
+static void Usage()
+{
+	std::cerr <<
+		"usage: mdp-solve [options] <file.mdp | directory>...\n"
+		"  -o <dir>     write results into dir instead of next to each input\n"
+		"  -j <n>       scenarios solved at once, default all hardware threads\n"
+		"  -g <WxH>     grid size up to 16384x16384, default 20x20\n"
+		"  -r <x,y,d>   robot start, d is N/E/S/W, default 1,1,N\n"
+		"Each <name>.mdp gets a <name>.out holding the path and the command string.\n";
+}
+
+int main(int argc, char** argv)
+{
+	fs::path out_dir;
+	std::size_t workers = std::max(1u, std::thread::hardware_concurrency());
+	MDP::Point grid{ 20, 20 }, robot{ 1, 1 };
+	MDP::FaceDirection robot_dir = MDP::FD_North;
+	std::vector<fs::path> inputs;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+		if (arg == "-o" && has_value)
+			out_dir = argv[++i];
+		else if (arg == "-j" && has_value)
+			workers = std::max(1l, std::strtol(argv[++i], nullptr, 10));
+		else if (arg == "-g" && has_value) {
+			//poses are keyed by MAX_GRID_SIZE wide coordinates, a bigger grid would alias cells
+			if (!ParsePair(argv[++i], 'x', grid.x, grid.y) || grid.x <= 0 || grid.y <= 0 ||
+				grid.x > MDP::MAX_GRID_SIZE || grid.y > MDP::MAX_GRID_SIZE) {
+				Usage();
+				return 2;
+			}
+		}
+		else if (arg == "-r" && has_value) {
+			std::string value = argv[++i];
+			auto comma = value.rfind(',');
+			const char* dirs = "NESW";
+			const char* d = comma == std::string::npos || value.size() != comma + 2 ? nullptr :
+				std::strchr(dirs, value[comma + 1]);
+			if (!d || !ParsePair(value.substr(0, comma).c_str(), ',', robot.x, robot.y)) {
+				Usage();
+				return 2;
+			}
+			robot_dir = static_cast<MDP::FaceDirection>(MDP::FD_North + (d - dirs));
+		}
+		else if (arg == "-h" || arg == "--help" || arg[0] == '-') {
+			Usage();
+			return arg[0] == '-' && arg != "-h" && arg != "--help" ? 2 : 0;
+		}
+		else
+			inputs.push_back(arg);
+	}
+
+	//the solver's search arrays are indexed by the robot's pose, so it has to start on the grid
+	if (robot.x < 0 || robot.x >= grid.x || robot.y < 0 || robot.y >= grid.y) {
+		std::cerr << "robot start " << robot.x << "," << robot.y << " is outside the "
+			<< grid.x << "x" << grid.y << " grid\n";
+		return 2;
+	}
+
+	std::vector<Scenario> scenarios;
+	for (auto& input : inputs) {
+		std::error_code ec;
+		if (fs::is_directory(input, ec)) {
+			std::vector<fs::path> files;
+			for (auto& entry : fs::directory_iterator(input, ec))
+				if (entry.is_regular_file() && entry.path().extension() == ".mdp")
+					files.push_back(entry.path());
+			std::sort(files.begin(), files.end());
+			for (auto& f : files)
+				scenarios.emplace_back().input = f;
+		}
+		else
+			scenarios.emplace_back().input = input;
+	}
+	if (scenarios.empty()) {
+		Usage();
+		return 2;
+	}
+	if (!out_dir.empty())
+		fs::create_directories(out_dir);
+	for (auto& s : scenarios) {
+		s.output = s.input;
+		s.output.replace_extension(".out");
+		if (!out_dir.empty())
+			s.output = out_dir / s.output.filename();
+	}
+
+	//view poses are kept on the grid through the Config buffers, not the solver's Grid
+	MDP::Config::get().Set_WIDTH_BUFFER(static_cast<int>(grid.x));
+	MDP::Config::get().Set_HEIGHT_BUFFER(static_cast<int>(grid.y));
+	//parallel across scenarios, so each solver keeps its combination search on one thread
+	MDP::Config::get().Set_THREADS(1);
+	auto start = std::chrono::steady_clock::now();
+	Utils::parallel_for(scenarios.size(), std::min(workers, scenarios.size()), 1,
+		[&](std::size_t, std::size_t i) {
+			Solve(scenarios[i], grid, robot, robot_dir);
+		});
+	double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::size_t failed = 0;
+	for (auto& s : scenarios) {
+		if (s.ok)
+			std::cout << s.input.string() << ": " << s.poses << " poses, " << s.commands << " commands, " << s.ms << " ms\n";
+		else {
+			failed++;
+			std::cout << s.input.string() << ": FAILED " << s.error << "\n";
+		}
+	}
+	std::cout << scenarios.size() << " scenarios, " << failed << " failed, " << elapsed << " ms on "
+		<< std::min(workers, scenarios.size()) << " threads" << std::endl;
+	return failed ? 1 : 0;
+}
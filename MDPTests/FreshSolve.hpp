@@ -0,0 +1,53 @@
+#pragma once
+#include "MazeSolver.hpp"
+#include "SeededLayout.hpp"
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+//Tour costs from legs that were repaired or reused after the layout changed, against a
+//fresh MazeSolver searching every leg again. Ties may pick other paths, the optimal cost
+//can't differ.
+namespace FreshSolve {
+	const MDP::Point GRID{ 20, 20 };
+	inline int failures = 0;
+
+	//cost of the tour the solve settled on, UNREACHABLE when it found none
+	inline int TourCost(MDP::MazeSolver& solver)
+	{
+		int cost = TSP::UNREACHABLE;
+		solver.GetOptimalOrderDP(false, MDP::MazeSolver::Deadline::max(),
+			[&cost](const std::vector<MDP::ObjectState>&, int total) { cost = total; });
+		return cost;
+	}
+
+	inline int FreshCost(const std::vector<std::shared_ptr<MDP::FieldBlock>>& obstacles, const MDP::Point& robot,
+		MDP::FaceDirection robot_dir)
+	{
+		MDP::MazeSolver solver(GRID, robot, robot_dir);
+		for (auto& o : obstacles)
+			solver.AddObstacle(o);
+		return TourCost(solver);
+	}
+
+	inline void Check(int got, int expected, const char* what, int layout, int step)
+	{
+		if (got == expected)
+			return;
+		failures++;
+		std::cerr << what << " layout " << layout << " step " << step << ": " << got << ", fresh solver " << expected << "\n";
+	}
+
+	inline std::shared_ptr<MDP::FieldBlock> MakeObstacle(std::mt19937& rng, int id)
+	{
+		auto [loc, fd] = Seeded::MakeLayout(rng, 1, GRID).obstacles[0];
+		return std::make_shared<MDP::FieldBlock>(loc, fd, id);
+	}
+
+	inline int Report()
+	{
+		std::cout << failures << " failures\n";
+		return failures == 0 ? 0 : 1;
+	}
+}
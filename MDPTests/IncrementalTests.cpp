@@ -0,0 +1,32 @@
+#include "FreshSolve.hpp"
+
+//one solver kept across AddObstacle and UpdateRobot calls, its reverse trees repaired in place
+
+using namespace FreshSolve;
+
+namespace {
+	void CheckIncremental(std::mt19937& rng, int layout)
+	{
+		MDP::MazeSolver solver(GRID, { 1, 1 }, MDP::FD_North);
+		solver.EnableIncrementalSearch(true);
+		std::vector<std::shared_ptr<MDP::FieldBlock>> obstacles;
+		for (int i = 0; i < 6; i++)
+		{
+			obstacles.push_back(MakeObstacle(rng, i));
+			solver.AddObstacle(obstacles.back());
+			Check(TourCost(solver), FreshCost(obstacles, { 1, 1 }, MDP::FD_North), "incremental", layout, i);
+		}
+		MDP::Point robot{ 1 + Seeded::Draw(rng, 3), 1 + Seeded::Draw(rng, 3) };
+		auto robot_dir = Seeded::DrawDirection(rng);
+		solver.UpdateRobot(robot, robot_dir);
+		Check(TourCost(solver), FreshCost(obstacles, robot, robot_dir), "incremental moved robot", layout, 6);
+	}
+}
+
+int main()
+{
+	std::mt19937 rng(7);
+	for (int layout = 0; layout < 10; layout++)
+		CheckIncremental(rng, layout);
+	return Report();
+}
@@ -0,0 +1,43 @@
+#include "FreshSolve.hpp"
+
+//a new solver per edit sharing one PathCache, as the UI runs them; an edit must invalidate
+//every cached leg it could have changed
+
+using namespace FreshSolve;
+
+int main()
+{
+	std::mt19937 rng(7);
+	for (int layout = 0; layout < 10; layout++)
+	{
+		auto cache = std::make_shared<MDP::PathCache>();
+		std::vector<std::shared_ptr<MDP::FieldBlock>> obstacles;
+		for (int i = 0; i < 3; i++)
+			obstacles.push_back(MakeObstacle(rng, i));
+		for (int edit = 0; edit < 8; edit++)
+		{
+			auto& o = obstacles[Seeded::Draw(rng, static_cast<int>(obstacles.size()))];
+			switch (Seeded::Draw(rng, 3))
+			{
+			case 0:
+				if (obstacles.size() < 6) {
+					obstacles.push_back(MakeObstacle(rng, static_cast<int>(obstacles.size())));
+					break;
+				}
+				[[fallthrough]];
+			case 1:
+				o->Update(o->GetLoc(), Seeded::DrawDirection(rng));
+				break;
+			default:
+				o->Update(MakeObstacle(rng, 0)->GetLoc(), o->GetDirection());
+				break;
+			}
+			MDP::MazeSolver solver(GRID, { 1, 1 }, MDP::FD_North);
+			solver.SetPathCache(cache);
+			for (auto& obstacle : obstacles)
+				solver.AddObstacle(obstacle);
+			Check(TourCost(solver), FreshCost(obstacles, { 1, 1 }, MDP::FD_North), "path cache", layout, edit);
+		}
+	}
+	return Report();
+}
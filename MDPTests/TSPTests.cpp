@@ -0,0 +1,188 @@
+#include "TSP.hpp"
+#include "SeededLayout.hpp"
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+//Held-Karp against brute force on small random instances with UNREACHABLE legs, once on
+//the scalar kernel and once on the SIMD one when the CPU has it
+
+namespace {
+	int failures = 0;
+
+	void Check(bool ok, const char* what, int instance)
+	{
+		if (ok)
+			return;
+		failures++;
+		std::cerr << "instance " << instance << ": " << what << "\n";
+	}
+
+	std::vector<std::vector<int>> MakeMatrix(std::mt19937& rng, int n)
+	{
+		std::vector<std::vector<int>> m(n, std::vector<int>(n, 0));
+		for (int p = 0; p < n; p++)
+		{
+			for (int q = 0; q < n; q++)
+			{
+				if (p != q)
+					m[p][q] = Seeded::Draw(rng, 5) == 0 ? TSP::UNREACHABLE : 1 + Seeded::Draw(rng, 100);
+			}
+		}
+		return m;
+	}
+
+	//cost of leaving 0, visiting order and returning to 0, UNREACHABLE if a leg is
+	long long TourCost(const std::vector<std::vector<int>>& m, const std::vector<int>& order)
+	{
+		long long total = 0;
+		int at = 0;
+		for (std::size_t i = 0; i <= order.size(); i++)
+		{
+			int next = i < order.size() ? order[i] : 0;
+			if (m[at][next] == TSP::UNREACHABLE)
+				return TSP::UNREACHABLE;
+			total += m[at][next];
+			at = next;
+		}
+		return total;
+	}
+
+	//best tour through one node of every group, nodes 1..n-1 belong to group[p]
+	long long BruteForceGrouped(const std::vector<std::vector<int>>& m, const std::vector<int>& group,
+		const std::vector<int>& penalty, int group_count)
+	{
+		int n = static_cast<int>(m.size());
+		long long best = TSP::UNREACHABLE;
+		std::vector<int> pick(group_count, 0);
+		std::vector<std::vector<int>> members(group_count);
+		for (int p = 1; p < n; p++)
+			members[group[p]].push_back(p);
+		while (true)
+		{
+			std::vector<int> order;
+			long long penalties = 0;
+			for (int g = 0; g < group_count; g++)
+			{
+				order.push_back(members[g][pick[g]]);
+				penalties += penalty[order.back()];
+			}
+			std::sort(order.begin(), order.end());
+			do {
+				long long cost = TourCost(m, order);
+				if (cost != TSP::UNREACHABLE)
+					best = std::min(best, cost + penalties);
+			} while (std::next_permutation(order.begin(), order.end()));
+			int g = 0;
+			while (g < group_count && ++pick[g] == static_cast<int>(members[g].size()))
+				pick[g++] = 0;
+			if (g == group_count)
+				break;
+		}
+		return best;
+	}
+
+	TSP::CostMatrix ToCostMatrix(const std::vector<std::vector<int>>& m)
+	{
+		TSP::CostMatrix costs;
+		int n = static_cast<int>(m.size());
+		costs.resize(n);
+		for (int p = 0; p < n; p++)
+			std::copy(m[p].begin(), m[p].end(), costs[p]);
+		return costs;
+	}
+
+	//the permutation starts at 0, visits one node per group and costs what the solver says
+	void CheckResult(const TSP::TSP_Result& result, long long expected, const std::vector<std::vector<int>>& m,
+		const std::vector<int>& group, const std::vector<int>& penalty, int group_count, int instance)
+	{
+		Check(result.best_distance == expected, "best distance differs from brute force", instance);
+		if (result.best_distance == TSP::UNREACHABLE || m.empty())
+			return;
+		Check(!result.permutation.empty() && result.permutation[0] == 0, "tour does not start at 0", instance);
+		if (result.permutation.size() != static_cast<std::size_t>(group_count) + 1)
+		{
+			Check(false, "tour visits the wrong number of nodes", instance);
+			return;
+		}
+		std::vector<int> order(result.permutation.begin() + 1, result.permutation.end());
+		std::vector<bool> seen(group_count, false);
+		long long penalties = 0;
+		for (int p : order)
+		{
+			Check(!seen[group[p]], "tour visits a group twice", instance);
+			seen[group[p]] = true;
+			penalties += penalty[p];
+		}
+		Check(TourCost(m, order) + penalties == result.best_distance, "tour does not cost best distance", instance);
+	}
+}
+
+int main()
+{
+	std::mt19937 rng(1);
+	std::vector<bool> kernels{ false };
+	if (TSP::simd_available())
+		kernels.push_back(true);
+	else
+		std::cout << "no SIMD kernel on this CPU, checking the scalar one only\n";
+
+	int instance = 0;
+	for (int n = 1; n <= 9; n++)
+	{
+		for (int t = 0; t < 40; t++, instance++)
+		{
+			auto m = MakeMatrix(rng, n);
+			std::vector<int> group(n), penalty(n, 0);
+			for (int p = 0; p < n; p++)
+				group[p] = p - 1;
+			long long expected = BruteForceGrouped(m, group, penalty, n - 1);
+			auto costs = ToCostMatrix(m);
+			std::vector<int> nodes(n);
+			std::iota(nodes.begin(), nodes.end(), 0);
+			std::vector<std::vector<int>> permutations;
+			for (bool simd : kernels)
+			{
+				TSP::Solver solver;
+				solver.set_simd(simd);
+				CheckResult(solver.solve(m), expected, m, group, penalty, n - 1, instance);
+				CheckResult(solver.solve(costs, nodes), expected, m, group, penalty, n - 1, instance);
+				permutations.push_back(solver.last_result().permutation);
+			}
+			Check(permutations.front() == permutations.back(), "kernels break ties differently", instance);
+		}
+	}
+
+	for (int n = 2; n <= 10; n++)
+	{
+		for (int t = 0; t < 40; t++, instance++)
+		{
+			auto m = MakeMatrix(rng, n);
+			//every group gets at least one node
+			int group_count = 1 + Seeded::Draw(rng, std::min(n - 1, 4));
+			std::vector<int> group(n, -1), penalty(n, 0);
+			for (int p = 1; p < n; p++)
+			{
+				group[p] = p <= group_count ? p - 1 : Seeded::Draw(rng, group_count);
+				penalty[p] = Seeded::Draw(rng, 30);
+			}
+			long long expected = BruteForceGrouped(m, group, penalty, group_count);
+			auto costs = ToCostMatrix(m);
+			std::vector<std::vector<int>> permutations;
+			for (bool simd : kernels)
+			{
+				TSP::Solver solver;
+				solver.set_simd(simd);
+				CheckResult(solver.solve_grouped(costs, group, penalty, group_count), expected, m, group, penalty,
+					group_count, instance);
+				permutations.push_back(solver.last_result().permutation);
+			}
+			Check(permutations.front() == permutations.back(), "kernels break ties differently", instance);
+		}
+	}
+
+	std::cout << instance << " instances, " << failures << " failures\n";
+	return failures == 0 ? 0 : 1;
+}